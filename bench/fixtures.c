@@ -0,0 +1,97 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "fixtures.h"
+
+const char *const coins[NCOINS] = { "btc", "eth", "doge", "xrp", "ada", "sol", "ltc", "trx" };
+
+void sb_printf(struct strbuf *sb, const char *fmt, ...) {
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(sb->data + sb->len, sb->cap - sb->len, fmt, ap);
+        va_end(ap);
+        if (n >= 0 && sb->len + n < sb->cap) {
+            sb->len += n;
+            return;
+        }
+        sb->cap = sb->cap ? sb->cap * 2 : 4096;
+        while (sb->cap < sb->len + n + 1) sb->cap *= 2;
+        sb->data = realloc(sb->data, sb->cap);
+    }
+}
+
+char *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc(size + 1);
+    *len = fread(data, 1, size, f);
+    data[*len] = '\0';
+    fclose(f);
+    return data;
+}
+
+// <dir>/<method>.json, or NULL when there is no such recording
+char *load_recorded(const char *dir, const char *method, size_t *len) {
+    if (!dir) return NULL;
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.json", dir, method);
+    return read_file(path, len);
+}
+
+// The real coins first, then made-up ones, so hundreds of pairs stay distinct
+const char *coin_name(int i, char *buf, size_t size) {
+    if (i < NCOINS) return coins[i];
+    snprintf(buf, size, "c%03d", i);
+    return buf;
+}
+
+// openOrders with count orders dealt round-robin over pairs pairs. At churn
+// step s, orders 0..s-1 are closed, order s is half filled and orders
+// count..count+s-1 are newly placed.
+void make_orders(struct strbuf *sb, int count, int pairs, long step) {
+    char name[16];
+    int last = count + (int)step;
+    if (pairs < 1) pairs = 1;
+    sb_printf(sb, "{\"success\":1,\"return\":{\"orders\":{");
+    for (int c = 0; c < pairs; c++) {
+        const char *coin = coin_name(c, name, sizeof(name));
+        sb_printf(sb, "%s\"%s_idr\":[", c ? "," : "", coin);
+        int first = 1;
+        for (int i = c; i < last; i += pairs) {
+            if (i < step) continue;
+            int buy = i % 2 == 0;
+            int partial = step > 0 && i == step;
+            sb_printf(sb, "%s{\"order_id\":\"%d\",\"client_order_id\":\"%sidr-%d-idX\",\"submit_time\":\"1754452495\","
+                          "\"price\":\"%d\",\"type\":\"%s\",\"order_type\":\"limit\",",
+                      first ? "" : ",", 1000 + i, coin, i, 1000 + i * 7, buy ? "buy" : "sell");
+            if (buy) {
+                sb_printf(sb, "\"order_idr\":\"100000\",\"remain_idr\":\"%d\"}", (50000 + i) / (partial ? 2 : 1));
+            } else {
+                sb_printf(sb, "\"order_%s\":\"10.00000000\",\"remain_%s\":\"%d.12345678\"}", coin, coin,
+                          partial ? 0 : i % 10);
+            }
+            first = 0;
+        }
+        sb_printf(sb, "]");
+    }
+    sb_printf(sb, "}}}");
+}
+
+// getInfo with an IDR balance and assets more, a third of them partly on hold
+void make_info(struct strbuf *sb, int assets) {
+    sb_printf(sb, "{\"success\":1,\"return\":{\"server_time\":1754452495,\"balance\":{\"idr\":12345678");
+    for (int i = 0; i < assets; i++) {
+        sb_printf(sb, ",\"%s%d\":\"%d.%08d\"", coins[i % NCOINS], i, i, i * 12345 % 100000000);
+    }
+    sb_printf(sb, "},\"balance_hold\":{\"idr\":\"100000\"");
+    for (int i = 0; i < assets; i++) {
+        sb_printf(sb, ",\"%s%d\":\"%s\"", coins[i % NCOINS], i, i % 3 ? "0.00000000" : "1.50000000");
+    }
+    sb_printf(sb, "},\"user_id\":\"1\",\"name\":\"bench\"}}");
+}
@@ -0,0 +1,27 @@
+#ifndef BENCH_FIXTURES_H
+#define BENCH_FIXTURES_H
+
+#include <stddef.h>
+
+// Synthetic /tapi bodies shared by bench/mock_tapi.c and the benchmarks, so
+// they all serve and measure the same shapes.
+
+#define NCOINS 8
+extern const char *const coins[NCOINS];
+
+struct strbuf {
+    char *data;
+    size_t len;
+    size_t cap;
+};
+
+void sb_printf(struct strbuf *sb, const char *fmt, ...);
+
+char *read_file(const char *path, size_t *len);
+char *load_recorded(const char *dir, const char *method, size_t *len);
+
+const char *coin_name(int i, char *buf, size_t size);
+void make_orders(struct strbuf *sb, int count, int pairs, long step);
+void make_info(struct strbuf *sb, int assets);
+
+#endif
@@ -0,0 +1,421 @@
+// Microbenchmarks for the CPU paths between a /tapi reply and stdout: the
+// request signer, WriteMemoryCallback, extract_coin_name, json_value_to_dec
+// and the format_* writers, on synthetic openOrders and getInfo bodies of any
+// size. Every case runs in a child process of its own so the peak RSS it
+// reports is its own, and malloc, calloc and realloc are interposed to count
+// the allocations each call makes.
+//
+//   microbench [-n orders,...] [-a assets,...] [-t seconds] [-o file] [-b baseline] [-r pct]
+//
+// Results are JSON (stdout, or -o file), one case per line. With -b each case
+// is compared against the same case in an earlier run, and the run fails when
+// one got more than pct percent (default 10) slower or allocates more per call.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "../sign.h"
+#include "../response.h"
+#include "../format.h"
+#include "fixtures.h"
+
+#define MIN_SECONDS 0.3
+#define CHUNK 16384             // CURL_MAX_WRITE_SIZE, what libcurl hands the write callback
+
+// --- allocation counting ---
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static unsigned long alloc_calls = 0;
+static unsigned long alloc_bytes = 0;
+
+void *malloc(size_t size) {
+    alloc_calls++;
+    alloc_bytes += size;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    alloc_calls++;
+    alloc_bytes += n * size;
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    alloc_calls++;
+    alloc_bytes += size;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+// --- fixtures ---
+
+static const char trade_body[] =
+    "{\"success\":1,\"return\":{\"receive_doge\":\"0\",\"remain_doge\":\"66.66666666\",\"order_id\":1234,"
+    "\"client_order_id\":\"dogeidr-mvbkwr9p-bmnq0-idX\",\"type\":\"buy\",\"balance\":{\"idr\":\"1000000\"}}}";
+static const char cancel_body[] =
+    "{\"success\":1,\"return\":{\"order_id\":1234,\"client_order_id\":\"dogeidr-mvbkwr9p-bmnq0-idX\","
+    "\"type\":\"buy\",\"pair\":\"doge_idr\",\"balance\":{\"idr\":\"1000000\"}}}";
+
+// --- cases ---
+
+struct bench_ctx {
+    char *body;
+    size_t len;
+    struct output out;
+    struct MemoryStruct mem;
+    int cold;
+    struct hmac_signer signer;
+    const char *postdata;
+    size_t postdata_len;
+    char hex[SIGN_HEX_LEN + 1];
+    struct json_view value;
+    dec64 sink;
+};
+
+static void op_sign(struct bench_ctx *c) {
+    hmac_signer_sign(&c->signer, c->postdata, c->postdata_len, c->hex);
+}
+
+// One whole body, in the chunks libcurl delivers it in
+static void op_write_callback(struct bench_ctx *c) {
+    if (c->cold) response_free(&c->mem);
+    response_reset(&c->mem, NULL);
+    for (size_t off = 0; off < c->len; off += CHUNK) {
+        size_t n = c->len - off < CHUNK ? c->len - off : CHUNK;
+        WriteMemoryCallback(c->body + off, 1, n, &c->mem);
+    }
+}
+
+static void op_extract_coin_name(struct bench_ctx *c) {
+    char *coin = extract_coin_name("doge_idr");
+    c->sink += coin[0];
+    free(coin);
+}
+
+static void op_json_value_to_dec(struct bench_ctx *c) {
+    c->sink += json_value_to_dec(&c->value);
+}
+
+static void op_orders(struct bench_ctx *c) {
+    format_orders_table(&c->out, c->body, c->len, NULL);
+    c->out.buf.len = 0;
+}
+
+static void op_getinfo(struct bench_ctx *c) {
+    format_getinfo_table(&c->out, c->body, c->len);
+    c->out.buf.len = 0;
+}
+
+static void op_trade(struct bench_ctx *c) {
+    format_trade_response_table(&c->out, c->body, c->len, "doge", "1500");
+    c->out.buf.len = 0;
+}
+
+static void op_cancel(struct bench_ctx *c) {
+    format_cancel_table(&c->out, c->body, c->len);
+    c->out.buf.len = 0;
+}
+
+enum fixture {
+    FIX_NONE,
+    FIX_ORDERS,
+    FIX_INFO,
+    FIX_TRADE,
+    FIX_CANCEL
+};
+
+struct bench_case {
+    const char *name;
+    const char *variant;
+    long n;                     // orders or assets in the fixture, 0 for a fixed input
+    enum fixture fixture;
+    void (*op)(struct bench_ctx *c);
+};
+
+struct result {
+    char name[40];
+    char variant[16];
+    long n;
+    long iterations;
+    double ns_per_op;
+    double allocs_per_op;
+    double alloc_bytes_per_op;
+    long peak_rss_kb;
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void setup(const struct bench_case *bc, struct bench_ctx *c, int pairs) {
+    struct strbuf sb = {0};
+    memset(c, 0, sizeof(*c));
+    c->out.format = OUTPUT_TABLE;
+    output_parse(bc->variant, &c->out.format);
+    c->cold = strcmp(bc->variant, "cold") == 0;
+    switch (bc->fixture) {
+    case FIX_ORDERS: make_orders(&sb, (int)bc->n, pairs, 0); break;
+    case FIX_INFO: make_info(&sb, (int)bc->n); break;
+    case FIX_TRADE: c->body = strdup(trade_body); c->len = sizeof(trade_body) - 1; break;
+    case FIX_CANCEL: c->body = strdup(cancel_body); c->len = sizeof(cancel_body) - 1; break;
+    default: break;
+    }
+    if (sb.data) {
+        c->body = sb.data;
+        c->len = sb.len;
+    }
+
+    const char *secret = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+    hmac_signer_init(&c->signer, secret, strlen(secret));
+    c->postdata = "method=trade&timestamp=1754452495000&recvWindow=1804352495000&pair=doge_idr"
+                  "&type=buy&price=1500&idr=100000&client_order_id=dogeidr-mvbkwr9p-bmnq0-idX";
+    c->postdata_len = strlen(c->postdata);
+
+    static const char number[] = "12345.12345678";
+    c->value.kind = JV_STRING;
+    c->value.text.ptr = number;
+    c->value.text.len = sizeof(number) - 1;
+}
+
+// Runs one case after a warm-up call (which grows buffers to size), doubling
+// the batch until min_sec has passed.
+static void measure(const struct bench_case *bc, int pairs, double min_sec, struct result *r) {
+    struct bench_ctx c;
+    setup(bc, &c, pairs);
+    bc->op(&c);
+
+    long iterations = 0, batch = 1;
+    unsigned long calls0 = alloc_calls, bytes0 = alloc_bytes;
+    double t0 = now_sec(), elapsed;
+    do {
+        for (long i = 0; i < batch; i++) bc->op(&c);
+        iterations += batch;
+        elapsed = now_sec() - t0;
+        if (batch < (1L << 20)) batch *= 2;
+    } while (elapsed < min_sec);
+
+    r->iterations = iterations;
+    r->ns_per_op = elapsed * 1e9 / iterations;
+    r->allocs_per_op = (double)(alloc_calls - calls0) / iterations;
+    r->alloc_bytes_per_op = (double)(alloc_bytes - bytes0) / iterations;
+}
+
+// Forks so the child's ru_maxrss covers this case alone.
+static int run_case(const struct bench_case *bc, int pairs, double min_sec, struct result *r) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        return 0;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 0;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        memset(r, 0, sizeof(*r));
+        measure(bc, pairs, min_sec, r);
+        ssize_t n = write(fds[1], r, sizeof(*r));
+        _exit(n == (ssize_t)sizeof(*r) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t n = read(fds[0], r, sizeof(*r));
+    close(fds[0]);
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) < 0 || n != (ssize_t)sizeof(*r) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        fprintf(stderr, "%s %s n=%ld: child failed\n", bc->name, bc->variant, bc->n);
+        return 0;
+    }
+    snprintf(r->name, sizeof(r->name), "%s", bc->name);
+    snprintf(r->variant, sizeof(r->variant), "%s", bc->variant);
+    r->n = bc->n;
+    r->peak_rss_kb = ru.ru_maxrss;
+    return 1;
+}
+
+// --- baseline ---
+
+static double view_number(const struct json_view *obj, const char *key) {
+    struct json_view v;
+    char buf[64];
+    if (!jv_object_get(obj, key, &v) || (v.kind != JV_NUMBER && v.kind != JV_STRING)) return -1;
+    return atof(jv_copy(v.text, buf, sizeof(buf)));
+}
+
+// Finds r's case in a results file, with the same reader the client uses for /tapi replies.
+static int baseline_find(const struct json_view *results, const struct result *r, double *ns, double *allocs) {
+    struct json_iter it;
+    struct json_view entry, v;
+    jv_iter_init(&it, results);
+    while (jv_array_next(&it, &entry) > 0) {
+        if (entry.kind != JV_OBJECT) continue;
+        if (!jv_object_get(&entry, "name", &v) || !sv_eq(v.text, r->name)) continue;
+        if (!jv_object_get(&entry, "variant", &v) || !sv_eq(v.text, r->variant)) continue;
+        if ((long)view_number(&entry, "n") != r->n) continue;
+        *ns = view_number(&entry, "ns_per_op");
+        *allocs = view_number(&entry, "allocs_per_op");
+        return *ns > 0;
+    }
+    return 0;
+}
+
+// Prints every case next to its baseline; returns the number of regressions.
+static int compare(const char *path, const struct result *results, size_t count, double pct) {
+    size_t len;
+    char *data = read_file(path, &len);
+    struct json_view root, list;
+    size_t offset;
+    if (!data || !jv_parse(data, len, &root, &offset) || root.kind != JV_OBJECT ||
+        !jv_object_get(&root, "results", &list) || list.kind != JV_ARRAY) {
+        fprintf(stderr, "Cannot read baseline %s\n", path);
+        free(data);
+        return -1;
+    }
+
+    int regressions = 0;
+    fprintf(stderr, "%-28s %-6s %8s %12s %12s %8s %15s\n", "vs baseline", "", "n", "base ns", "ns/op", "change", "allocs/op");
+    for (size_t i = 0; i < count; i++) {
+        const struct result *r = &results[i];
+        double ns, allocs;
+        if (!baseline_find(&list, r, &ns, &allocs)) {
+            fprintf(stderr, "%-28s %-6s %8ld %12s %12.1f %8s\n", r->name, r->variant, r->n, "-", r->ns_per_op, "new");
+            continue;
+        }
+        double change = (r->ns_per_op / ns - 1) * 100;
+        int slower = change > pct;
+        int more_allocs = r->allocs_per_op > allocs + 0.01;
+        regressions += slower || more_allocs;
+        fprintf(stderr, "%-28s %-6s %8ld %12.1f %12.1f %+7.1f%% %6.2f -> %-6.2f%s\n", r->name, r->variant, r->n,
+                ns, r->ns_per_op, change, allocs, r->allocs_per_op, slower || more_allocs ? "  REGRESSION" : "");
+    }
+    free(data);
+    return regressions;
+}
+
+// --- driver ---
+
+static int parse_list(const char *arg, long *out, int max) {
+    int n = 0;
+    for (const char *p = arg; *p && n < max; p += strcspn(p, ",") + (p[strcspn(p, ",")] == ',')) {
+        long v = atol(p);
+        if (v > 0) out[n++] = v;
+    }
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    long orders[16] = { 10, 1000, 100000, 1000000 };
+    long assets[16] = { 10, 100, 500 };
+    int norders = 4, nassets = 3;
+    double min_sec = MIN_SECONDS, pct = 10;
+    const char *out_path = NULL, *baseline = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:a:t:o:b:r:")) != -1) {
+        switch (opt) {
+        case 'n': norders = parse_list(optarg, orders, 16); break;
+        case 'a': nassets = parse_list(optarg, assets, 16); break;
+        case 't': min_sec = atof(optarg); break;
+        case 'o': out_path = optarg; break;
+        case 'b': baseline = optarg; break;
+        case 'r': pct = atof(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-n orders,...] [-a assets,...] [-t seconds] [-o file] [-b baseline] [-r pct]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    static const char *formats[] = { "table", "jsonl", "csv" };
+    // Three fixed cases, two per order count, and one per size and trade/cancel for each format
+    struct bench_case *cases = calloc((size_t)(3 + 2 * norders + 3 * (norders + nassets + 2)), sizeof(*cases));
+    size_t ncases = 0;
+    if (!cases) {
+        perror("calloc");
+        return 1;
+    }
+    cases[ncases++] = (struct bench_case){ "hmac_signer_sign", "-", 0, FIX_NONE, op_sign };
+    cases[ncases++] = (struct bench_case){ "extract_coin_name", "-", 0, FIX_NONE, op_extract_coin_name };
+    cases[ncases++] = (struct bench_case){ "json_value_to_dec", "-", 0, FIX_NONE, op_json_value_to_dec };
+    for (int i = 0; i < norders; i++) {
+        cases[ncases++] = (struct bench_case){ "WriteMemoryCallback", "warm", orders[i], FIX_ORDERS, op_write_callback };
+        cases[ncases++] = (struct bench_case){ "WriteMemoryCallback", "cold", orders[i], FIX_ORDERS, op_write_callback };
+    }
+    for (int f = 0; f < 3; f++) {
+        for (int i = 0; i < norders; i++) {
+            cases[ncases++] = (struct bench_case){ "format_orders_table", formats[f], orders[i], FIX_ORDERS, op_orders };
+        }
+        for (int i = 0; i < nassets; i++) {
+            cases[ncases++] = (struct bench_case){ "format_getinfo_table", formats[f], assets[i], FIX_INFO, op_getinfo };
+        }
+        cases[ncases++] = (struct bench_case){ "format_trade_response_table", formats[f], 0, FIX_TRADE, op_trade };
+        cases[ncases++] = (struct bench_case){ "format_cancel_table", formats[f], 0, FIX_CANCEL, op_cancel };
+    }
+
+    // Orders are spread over the largest asset count, as on a busy account
+    int pairs = nassets ? (int)assets[nassets - 1] : 100;
+    struct result *results = calloc(ncases, sizeof(*results));
+    size_t count = 0;
+    if (!results) {
+        perror("calloc");
+        free(cases);
+        return 1;
+    }
+    for (size_t i = 0; i < ncases; i++) {
+        if (!run_case(&cases[i], pairs, min_sec, &results[count])) {
+            free(results);
+            free(cases);
+            return 1;
+        }
+        const struct result *r = &results[count++];
+        fprintf(stderr, "%-28s %-6s %8ld %14.1f ns/op %8.2f allocs/op %9ld KB peak\n",
+                r->name, r->variant, r->n, r->ns_per_op, r->allocs_per_op, r->peak_rss_kb);
+    }
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        perror(out_path);
+        free(results);
+        free(cases);
+        return 1;
+    }
+    fprintf(out, "{\"pairs\":%d,\"min_seconds\":%g,\"results\":[\n", pairs, min_sec);
+    for (size_t i = 0; i < count; i++) {
+        const struct result *r = &results[i];
+        fprintf(out, "{\"name\":\"%s\",\"variant\":\"%s\",\"n\":%ld,\"ns_per_op\":%.1f,\"ns_per_item\":%.2f,"
+                     "\"allocs_per_op\":%.3f,\"alloc_bytes_per_op\":%.0f,\"peak_rss_kb\":%ld,\"iterations\":%ld}%s\n",
+                r->name, r->variant, r->n, r->ns_per_op, r->n ? r->ns_per_op / r->n : r->ns_per_op,
+                r->allocs_per_op, r->alloc_bytes_per_op, r->peak_rss_kb, r->iterations, i + 1 < count ? "," : "");
+    }
+    fprintf(out, "]}\n");
+    if (out != stdout) fclose(out);
+
+    int rc = 0;
+    if (baseline) {
+        int regressions = compare(baseline, results, count, pct);
+        if (regressions < 0) rc = 1;
+        else if (regressions > 0) {
+            fprintf(stderr, "%d case%s regressed beyond %.0f%%\n", regressions, regressions == 1 ? "" : "s", pct);
+            rc = 1;
+        }
+    }
+    free(results);
+    free(cases);
+    return rc;
+}
@@ -0,0 +1,481 @@
+// Local stand-in for https://indodax.com/tapi. Checks the Key/Sign headers the
+// same way the exchange does and answers openOrders, trade,
+// cancelByClientOrderId, getOrderByClientOrderId, getInfo and tradeHistory
+// with synthetic or recorded bodies.
+// GET /api/depth/<pair>, /api/trades/<pair>, /api/ticker_all, /api/pairs,
+// /api/price_increments and /api/server_time serve synthetic public data.
+//
+//   mock_tapi [-p port] [-k key] [-s secret] [-n orders] [-a assets] [-l levels] [-t trades] [-d delay_us] [-r dir] [-w] [-S n]
+//
+// Port 0 picks a free port; the bound port is printed on stdout as "port N".
+// With -r, <dir>/<method>.json is served verbatim when it exists. With -w every
+// openOrders reply closes, partly fills and places one more order than the last,
+// and getOrder reports the closed ones, for exercising watch. With -S every
+// nth signed request stalls for STALL_US before it is answered; a stalled trade
+// or cancel has already taken effect, and getOrderByClientOrderId reports it,
+// for exercising timeouts and retries.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "../sign.h"
+#include "fixtures.h"
+
+#define MAX_HEAD 8192
+#define MAX_BODY 4096
+
+static const char *api_key = "benchkey";
+static struct hmac_signer signer;
+static int order_count = 100;
+static int asset_count = 20;
+static int depth_levels = 50;
+static int trade_count = 2500;     // fills per pair in tradeHistory
+static useconds_t delay_us = 0;
+static const char *record_dir = NULL;
+
+static char *orders_body = NULL;
+static size_t orders_len = 0;
+static char *info_body = NULL;
+static size_t info_len = 0;
+
+static char *depth_body = NULL;
+static size_t depth_len = 0;
+static char *tickers_body = NULL;
+static size_t tickers_len = 0;
+static char *pairs_body = NULL;
+static size_t pairs_len = 0;
+static char *increments_body = NULL;
+static size_t increments_len = 0;
+static const char trades_body[] =
+    "[{\"date\":\"1754452495\",\"price\":\"1001000\",\"amount\":\"0.5\",\"tid\":\"1\",\"type\":\"buy\"}]";
+
+static volatile long served = 0;
+static volatile long rejected = 0;
+static int churn = 0;
+static volatile long churn_step = 0;
+static int stall_every = 0;
+
+#define STALL_US 2000000
+#define PLACED_RING 1024
+
+// Orders placed through trade, for getOrderByClientOrderId
+static struct {
+    char coid[128];
+    char type[8];
+    char pair[32];
+    int cancelled;
+} placed[PLACED_RING];
+static long placed_count = 0;
+static pthread_mutex_t placed_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void build_bodies(void) {
+    struct strbuf sb = {0};
+
+    if (!(orders_body = load_recorded(record_dir, "openOrders", &orders_len))) {
+        make_orders(&sb, order_count, NCOINS, 0);
+        orders_body = sb.data;
+        orders_len = sb.len;
+        memset(&sb, 0, sizeof(sb));
+    }
+
+    if (!(info_body = load_recorded(record_dir, "getInfo", &info_len))) {
+        make_info(&sb, asset_count);
+        info_body = sb.data;
+        info_len = sb.len;
+        memset(&sb, 0, sizeof(sb));
+    }
+
+    // Every pair shares one book: bids below 1,000,000 and asks above, 1000 apart
+    sb_printf(&sb, "{\"buy\":[");
+    for (int i = 0; i < depth_levels; i++) {
+        sb_printf(&sb, "%s[%d,\"%d.%04d\"]", i ? "," : "", 1000000 - i * 1000, i + 1, i * 37 % 10000);
+    }
+    sb_printf(&sb, "],\"sell\":[");
+    for (int i = 0; i < depth_levels; i++) {
+        sb_printf(&sb, "%s[%d,\"%d.%04d\"]", i ? "," : "", 1002000 + i * 1000, i + 1, i * 53 % 10000);
+    }
+    sb_printf(&sb, "]}");
+    depth_body = sb.data;
+    depth_len = sb.len;
+    memset(&sb, 0, sizeof(sb));
+
+    // A ticker for every asset getInfo reports, plus a USDT-quoted pair
+    if (!(tickers_body = load_recorded(record_dir, "ticker_all", &tickers_len))) {
+        sb_printf(&sb, "{\"tickers\":{\"btc_usdt\":{\"last\":\"65000\",\"buy\":\"64999\",\"sell\":\"65001\"}");
+        for (int i = 0; i < asset_count; i++) {
+            int last = 1000 * (i + 1);
+            sb_printf(&sb, ",\"%s%d_idr\":{\"high\":\"%d\",\"low\":\"%d\",\"vol_%s%d\":\"1234.5\",\"vol_idr\":\"9876543\","
+                           "\"last\":\"%d\",\"buy\":\"%d\",\"sell\":\"%d\",\"server_time\":1754452495}",
+                      coins[i % NCOINS], i, last + 50, last - 50, coins[i % NCOINS], i, last, last - 1, last + 1);
+        }
+        sb_printf(&sb, "}}");
+        tickers_body = sb.data;
+        tickers_len = sb.len;
+        memset(&sb, 0, sizeof(sb));
+    }
+
+    // Rules for the order coins: ticks of 1000 like the book, 10000 IDR
+    // minimum, and doge amounts limited to 4 decimals
+    if (!(pairs_body = load_recorded(record_dir, "pairs", &pairs_len))) {
+        sb_printf(&sb, "[{\"id\":\"btcusdt\",\"ticker_id\":\"btc_usdt\",\"price_round\":8,\"trade_min_base_currency\":5}");
+        for (size_t c = 0; c < NCOINS; c++) {
+            sb_printf(&sb, ",{\"id\":\"%sidr\",\"symbol\":\"%sIDR\",\"base_currency\":\"idr\",\"traded_currency\":\"%s\","
+                           "\"ticker_id\":\"%s_idr\",\"volume_precision\":0,\"price_precision\":1000,\"price_round\":%d,"
+                           "\"trade_min_base_currency\":10000,\"trade_min_traded_currency\":\"0.0001\",\"is_maintenance\":%d}",
+                      coins[c], coins[c], coins[c], coins[c], strcmp(coins[c], "doge") ? 8 : 4, strcmp(coins[c], "trx") == 0);
+        }
+        sb_printf(&sb, "]");
+        pairs_body = sb.data;
+        pairs_len = sb.len;
+        memset(&sb, 0, sizeof(sb));
+    }
+    if (!(increments_body = load_recorded(record_dir, "price_increments", &increments_len))) {
+        sb_printf(&sb, "{\"increments\":{\"btc_usdt\":\"0.01\"");
+        for (size_t c = 0; c < NCOINS; c++) sb_printf(&sb, ",\"%s_idr\":\"1000\"", coins[c]);
+        sb_printf(&sb, "}}");
+        increments_body = sb.data;
+        increments_len = sb.len;
+    }
+}
+
+// Copies the value of name from an x-www-form-urlencoded body.
+static int form_value(const char *body, const char *name, char *out, size_t size) {
+    size_t n = strlen(name);
+    const char *p = body;
+    while (p && *p) {
+        if (strncmp(p, name, n) == 0 && p[n] == '=') {
+            p += n + 1;
+            size_t len = strcspn(p, "&");
+            if (len >= size) len = size - 1;
+            memcpy(out, p, len);
+            out[len] = '\0';
+            return 1;
+        }
+        p = strchr(p, '&');
+        if (p) p++;
+    }
+    out[0] = '\0';
+    return 0;
+}
+
+static const char *header_value(const char *head, const char *name, char *out, size_t size) {
+    size_t n = strlen(name);
+    for (const char *p = head; (p = strchr(p, '\n')); ) {
+        p++;
+        if (strncasecmp(p, name, n) == 0 && p[n] == ':') {
+            p += n + 1;
+            while (*p == ' ') p++;
+            size_t len = strcspn(p, "\r\n");
+            if (len >= size) len = size - 1;
+            memcpy(out, p, len);
+            out[len] = '\0';
+            return out;
+        }
+    }
+    return NULL;
+}
+
+static int send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n <= 0) return 0;
+        data += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static int respond(int fd, const char *body, size_t len, int keep_alive) {
+    char head[256];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n%s\r\n",
+                     len, keep_alive ? "" : "Connection: close\r\n");
+    return send_all(fd, head, n) && send_all(fd, body, len);
+}
+
+// Every pair has fills 1..trade_count: two buys then a sell, prices drifting
+// up by 1000 per fill. Pages ascend from from_id, at most count (max 1000).
+static int trade_history(int fd, const char *body, int keep_alive) {
+    char pair[32], value[32], coin[32];
+    form_value(body, "pair", pair, sizeof(pair));
+    snprintf(coin, sizeof(coin), "%.*s", (int)strcspn(pair, "_"), pair);
+    long from = form_value(body, "from_id", value, sizeof(value)) ? atol(value) : 1;
+    long count = form_value(body, "count", value, sizeof(value)) ? atol(value) : 1000;
+    if (from < 1) from = 1;
+    if (count < 1 || count > 1000) count = 1000;
+
+    struct strbuf sb = {0};
+    sb_printf(&sb, "{\"success\":1,\"return\":{\"trades\":[");
+    for (long id = from; id < from + count && id <= trade_count; id++) {
+        sb_printf(&sb, "%s{\"trade_id\":\"%ld\",\"order_id\":\"%ld\",\"type\":\"%s\",\"%s\":\"0.%08ld\","
+                       "\"price\":\"%ld\",\"fee\":\"%ld\",\"trade_time\":\"%ld\",\"client_order_id\":\"%sidr-%ld-idX\"}",
+                  id == from ? "" : ",", id, 100000 + id, id % 3 == 0 ? "sell" : "buy", coin,
+                  1000000 + id % 1000, 1000000 + id * 1000, id % 7, 1754452495 + id, coin, id);
+    }
+    sb_printf(&sb, "]}}");
+    int ok = respond(fd, sb.data, sb.len, keep_alive);
+    free(sb.data);
+    return ok;
+}
+
+static void place(const char *coid, const char *type, const char *pair) {
+    pthread_mutex_lock(&placed_lock);
+    long i = placed_count++ % PLACED_RING;
+    snprintf(placed[i].coid, sizeof(placed[i].coid), "%s", coid);
+    snprintf(placed[i].type, sizeof(placed[i].type), "%s", type);
+    snprintf(placed[i].pair, sizeof(placed[i].pair), "%s", pair);
+    placed[i].cancelled = 0;
+    pthread_mutex_unlock(&placed_lock);
+}
+
+// Marks a placed order cancelled (when cancel is set) and formats its
+// getOrderByClientOrderId reply into out. Returns 0 for an unknown order.
+static int find_placed(const char *coid, int cancel, char *out, size_t size) {
+    int found = 0;
+    pthread_mutex_lock(&placed_lock);
+    long n = placed_count < PLACED_RING ? placed_count : PLACED_RING;
+    for (long i = 0; i < n; i++) {
+        if (strcmp(placed[i].coid, coid) != 0) continue;
+        if (cancel) placed[i].cancelled = 1;
+        snprintf(out, size,
+                 "{\"success\":1,\"return\":{\"order\":{\"order_id\":\"%ld\",\"client_order_id\":\"%s\","
+                 "\"type\":\"%s\",\"pair\":\"%s\",\"status\":\"%s\",\"submit_time\":\"1754452495\"}}}",
+                 1000 + i, coid, placed[i].type, placed[i].pair, placed[i].cancelled ? "cancelled" : "open");
+        found = 1;
+        break;
+    }
+    pthread_mutex_unlock(&placed_lock);
+    return found;
+}
+
+static int handle(int fd, const char *head, const char *body, int keep_alive) {
+    char key[128], sign[SIGN_HEX_LEN + 8], expect[SIGN_HEX_LEN + 1];
+    char method[64], small[1024];
+
+    hmac_signer_sign(&signer, body, strlen(body), expect);
+    if (!header_value(head, "Key", key, sizeof(key)) || strcmp(key, api_key) != 0 ||
+        !header_value(head, "Sign", sign, sizeof(sign)) || strcmp(sign, expect) != 0) {
+        __sync_fetch_and_add(&rejected, 1);
+        const char *err = "{\"success\":0,\"error\":\"Invalid credentials. API not found or session has expired.\",\"error_code\":\"invalid_credentials\"}";
+        return respond(fd, err, strlen(err), keep_alive);
+    }
+
+    if (delay_us) usleep(delay_us);
+    long nth = __sync_add_and_fetch(&served, 1);
+    int stall = stall_every > 0 && nth % stall_every == 0;
+
+    form_value(body, "method", method, sizeof(method));
+    // A trade or cancel stalls after it has taken effect, anything else before
+    if (stall && strcmp(method, "trade") != 0 && strcmp(method, "cancelByClientOrderId") != 0) usleep(STALL_US);
+    if (strcmp(method, "openOrders") == 0 && churn) {
+        struct strbuf sb = {0};
+        make_orders(&sb, order_count, NCOINS, __sync_fetch_and_add(&churn_step, 1));
+        int ok = respond(fd, sb.data, sb.len, keep_alive);
+        free(sb.data);
+        return ok;
+    }
+    if (strcmp(method, "openOrders") == 0) {
+        return respond(fd, orders_body, orders_len, keep_alive);
+    }
+    // Orders the churn closed: even ones filled, odd ones cancelled
+    if (strcmp(method, "getOrder") == 0) {
+        char id[32], pair[32];
+        form_value(body, "order_id", id, sizeof(id));
+        form_value(body, "pair", pair, sizeof(pair));
+        long i = atol(id) - 1000;
+        int n = snprintf(small, sizeof(small),
+                         "{\"success\":1,\"return\":{\"order\":{\"order_id\":\"%s\",\"price\":\"%ld\",\"type\":\"%s\","
+                         "\"status\":\"%s\",\"submit_time\":\"1754452495\",\"finish_time\":\"1754452600\"}}}",
+                         id, 1000 + i * 7, i % 2 ? "sell" : "buy", i % 2 ? "cancelled" : "filled");
+        return respond(fd, small, n, keep_alive);
+    }
+    if (strcmp(method, "getInfo") == 0) {
+        return respond(fd, info_body, info_len, keep_alive);
+    }
+    if (strcmp(method, "trade") == 0) {
+        char pair[32], type[8], idr[64], coid[128], coin[32];
+        form_value(body, "pair", pair, sizeof(pair));
+        form_value(body, "type", type, sizeof(type));
+        form_value(body, "idr", idr, sizeof(idr));
+        form_value(body, "client_order_id", coid, sizeof(coid));
+        snprintf(coin, sizeof(coin), "%.*s", (int)strcspn(pair, "_"), pair);
+        place(coid, type, pair);
+        if (stall) usleep(STALL_US);
+        int n = snprintf(small, sizeof(small),
+                         "{\"success\":1,\"return\":{\"receive_%s\":\"0\",\"remain_%s\":\"%s\",\"order_id\":%ld,"
+                         "\"client_order_id\":\"%s\",\"type\":\"%s\",\"balance\":{\"idr\":\"1000000\"}}}",
+                         strcmp(type, "buy") == 0 ? coin : "idr", strcmp(type, "buy") == 0 ? "idr" : coin,
+                         idr, served, coid, type);
+        return respond(fd, small, n, keep_alive);
+    }
+    if (strcmp(method, "cancelByClientOrderId") == 0) {
+        char coid[128];
+        form_value(body, "client_order_id", coid, sizeof(coid));
+        find_placed(coid, 1, small, sizeof(small));
+        if (stall) usleep(STALL_US);
+        int n = snprintf(small, sizeof(small),
+                         "{\"success\":1,\"return\":{\"order_id\":%ld,\"client_order_id\":\"%s\",\"type\":\"buy\","
+                         "\"pair\":\"btc_idr\",\"balance\":{\"idr\":\"1000000\"}}}", served, coid);
+        return respond(fd, small, n, keep_alive);
+    }
+    if (strcmp(method, "getOrderByClientOrderId") == 0) {
+        char coid[128];
+        form_value(body, "client_order_id", coid, sizeof(coid));
+        if (!find_placed(coid, 0, small, sizeof(small))) {
+            snprintf(small, sizeof(small), "{\"success\":0,\"error\":\"Order not found\",\"error_code\":\"order_not_found\"}");
+        }
+        return respond(fd, small, strlen(small), keep_alive);
+    }
+
+    if (strcmp(method, "tradeHistory") == 0) {
+        return trade_history(fd, body, keep_alive);
+    }
+
+    const char *err = "{\"success\":0,\"error\":\"Invalid request method\",\"error_code\":\"invalid_method\"}";
+    return respond(fd, err, strlen(err), keep_alive);
+}
+
+static int handle_public(int fd, const char *head, int keep_alive) {
+    if (delay_us) usleep(delay_us);
+    if (strncmp(head + 4, "/api/depth/", 11) == 0) {
+        return respond(fd, depth_body, depth_len, keep_alive);
+    }
+    if (strncmp(head + 4, "/api/trades/", 12) == 0) {
+        return respond(fd, trades_body, sizeof(trades_body) - 1, keep_alive);
+    }
+    if (strncmp(head + 4, "/api/ticker_all", 15) == 0) {
+        return respond(fd, tickers_body, tickers_len, keep_alive);
+    }
+    if (strncmp(head + 4, "/api/pairs", 10) == 0) {
+        return respond(fd, pairs_body, pairs_len, keep_alive);
+    }
+    if (strncmp(head + 4, "/api/price_increments", 21) == 0) {
+        return respond(fd, increments_body, increments_len, keep_alive);
+    }
+    if (strncmp(head + 4, "/api/server_time", 16) == 0) {
+        char body[96];
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        int n = snprintf(body, sizeof(body), "{\"timezone\":\"UTC\",\"server_time\":%lld}",
+                         (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+        return respond(fd, body, n, keep_alive);
+    }
+    const char *err = "{\"error\":\"invalid_pair\",\"error_description\":\"Invalid Pair\"}";
+    return respond(fd, err, strlen(err), keep_alive);
+}
+
+static void *connection(void *arg) {
+    int fd = (int)(long)arg;
+    char buf[MAX_HEAD + MAX_BODY + 1];
+    size_t len = 0;
+
+    for (;;) {
+        char *end;
+        while (!(end = memmem(buf, len, "\r\n\r\n", 4))) {
+            if (len >= MAX_HEAD) goto done;
+            ssize_t n = read(fd, buf + len, sizeof(buf) - 1 - len);
+            if (n <= 0) goto done;
+            len += n;
+        }
+
+        size_t head_len = end - buf + 4;
+        buf[head_len - 2] = '\0';
+        char value[64];
+        size_t body_len = header_value(buf, "Content-Length", value, sizeof(value)) ? strtoul(value, NULL, 10) : 0;
+        if (body_len > MAX_BODY) goto done;
+        int keep_alive = !(header_value(buf, "Connection", value, sizeof(value)) && strcasecmp(value, "close") == 0);
+
+        while (len < head_len + body_len) {
+            ssize_t n = read(fd, buf + len, sizeof(buf) - 1 - len);
+            if (n <= 0) goto done;
+            len += n;
+        }
+
+        if (strncmp(buf, "GET ", 4) == 0) {
+            if (!handle_public(fd, buf, keep_alive) || !keep_alive) goto done;
+            len -= head_len;
+            memmove(buf, buf + head_len, len);
+            continue;
+        }
+
+        char body[MAX_BODY + 1];
+        memcpy(body, buf + head_len, body_len);
+        body[body_len] = '\0';
+        if (!handle(fd, buf, body, keep_alive) || !keep_alive) goto done;
+
+        len -= head_len + body_len;
+        memmove(buf, buf + head_len + body_len, len);
+    }
+
+done:
+    close(fd);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int port = 0;
+    const char *secret = "benchsecret";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:k:s:n:a:l:t:d:r:wS:")) != -1) {
+        switch (opt) {
+        case 'p': port = atoi(optarg); break;
+        case 'k': api_key = optarg; break;
+        case 's': secret = optarg; break;
+        case 'n': order_count = atoi(optarg); break;
+        case 'a': asset_count = atoi(optarg); break;
+        case 'l': depth_levels = atoi(optarg); break;
+        case 't': trade_count = atoi(optarg); break;
+        case 'd': delay_us = (useconds_t)atol(optarg); break;
+        case 'r': record_dir = optarg; break;
+        case 'w': churn = 1; break;
+        case 'S': stall_every = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-p port] [-k key] [-s secret] [-n orders] [-a assets] [-l levels] [-t trades] [-d delay_us] [-r dir] [-w] [-S n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    hmac_signer_init(&signer, secret, strlen(secret));
+    build_bodies();
+    signal(SIGPIPE, SIG_IGN);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 128) < 0) {
+        perror("bind/listen");
+        return 1;
+    }
+
+    socklen_t alen = sizeof(addr);
+    getsockname(fd, (struct sockaddr *)&addr, &alen);
+    printf("port %d\n", ntohs(addr.sin_port));
+    fflush(stdout);
+
+    for (;;) {
+        int client = accept(fd, NULL, NULL);
+        if (client < 0) continue;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, connection, (void *)(long)client) != 0) {
+            close(client);
+            continue;
+        }
+        pthread_detach(tid);
+    }
+}
@@ -0,0 +1,215 @@
+// Compares the on-demand /tapi reader in tapi_json.c against the jansson DOM
+// path main.c used before it, on large openOrders and getInfo bodies.
+// Both paths must extract the same fields before any number is reported.
+//
+//   parse_bench [-n orders] [-a assets] [-i iterations] [-r dir]
+//
+// -r reads recorded <dir>/openOrders.json and <dir>/getInfo.json instead of
+// generating synthetic ones.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <jansson.h>
+#include "../tapi_json.h"
+#include "fixtures.h"
+
+// What both paths accumulate, so neither can skip work and both must agree
+struct digest {
+    size_t rows;
+    size_t bytes;
+    double total;
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// --- jansson path, as main.c walked openOrders and getInfo before tapi_json.c ---
+
+static size_t jstrlen(json_t *v) {
+    return json_is_string(v) ? strlen(json_string_value(v)) : 3;
+}
+
+static void legacy_order_array(json_t *order_array, const char *coin_name, struct digest *d) {
+    char remain_field[64];
+    snprintf(remain_field, sizeof(remain_field), "remain_%s", coin_name);
+
+    size_t index;
+    json_t *order;
+    json_array_foreach(order_array, index, order) {
+        json_t *price = json_object_get(order, "price");
+        json_t *orderid = json_object_get(order, "client_order_id");
+        json_t *type = json_object_get(order, "type");
+        json_t *remain = json_object_get(order, remain_field);
+        d->rows++;
+        d->bytes += jstrlen(price) + jstrlen(orderid) + jstrlen(type) + jstrlen(remain);
+    }
+}
+
+static int legacy_orders(const char *json, size_t len, struct digest *d) {
+    json_error_t error;
+    json_t *root = json_loadb(json, len, 0, &error);
+    if (!root) return 0;
+    json_t *orders = json_object_get(json_object_get(root, "return"), "orders");
+    const char *key;
+    json_t *array;
+    json_object_foreach(orders, key, array) {
+        char coin[32];
+        snprintf(coin, sizeof(coin), "%s", key);
+        char *us = strstr(coin, "_idr");
+        if (us) *us = '\0';
+        legacy_order_array(array, coin, d);
+    }
+    json_decref(root);
+    return 1;
+}
+
+static double legacy_double(json_t *value) {
+    if (json_is_real(value)) return json_real_value(value);
+    if (json_is_integer(value)) return (double)json_integer_value(value);
+    if (json_is_string(value)) return atof(json_string_value(value));
+    return 0.0;
+}
+
+static int legacy_info(const char *json, size_t len, struct digest *d) {
+    json_error_t error;
+    json_t *root = json_loadb(json, len, 0, &error);
+    if (!root) return 0;
+    json_t *ret = json_object_get(root, "return");
+    json_t *balance = json_object_get(ret, "balance");
+    json_t *balance_hold = json_object_get(ret, "balance_hold");
+    const char *asset;
+    json_t *value;
+    json_object_foreach(balance, asset, value) {
+        json_t *hold = json_object_get(balance_hold, asset);
+        d->rows++;
+        d->bytes += strlen(asset);
+        d->total += legacy_double(value) + (hold ? legacy_double(hold) : 0.0);
+    }
+    json_decref(root);
+    return 1;
+}
+
+// --- tapi_json path ---
+
+static size_t vlen(struct strview v) {
+    return v.ptr ? v.len : 3;
+}
+
+static void fast_order_row(const struct tapi_order *o, void *ctx) {
+    struct digest *d = ctx;
+    d->rows++;
+    d->bytes += vlen(o->price) + vlen(o->client_order_id) + vlen(o->type) + vlen(o->remain);
+}
+
+static int fast_orders(const char *json, size_t len, struct digest *d) {
+    struct json_view orders;
+    char err[192];
+    if (!tapi_find_orders(json, len, &orders, err, sizeof(err))) return 0;
+    return tapi_walk_orders(&orders, NULL, fast_order_row, d);
+}
+
+static double view_double(const struct json_view *v) {
+    char buf[64];
+    return atof(jv_copy(v->text, buf, sizeof(buf)));
+}
+
+static void fast_balance_row(struct strview asset, const struct json_view *available,
+                             const struct json_view *hold, void *ctx) {
+    struct digest *d = ctx;
+    if (!available) return;
+    d->rows++;
+    d->bytes += asset.len;
+    d->total += view_double(available) + (hold ? view_double(hold) : 0.0);
+}
+
+static int fast_info(const char *json, size_t len, struct digest *d) {
+    struct json_view ret, balance, hold;
+    char err[192];
+    if (!tapi_check_response(json, len, &ret, err, sizeof(err))) return 0;
+    if (!tapi_find_balances(&ret, &balance, &hold)) return 0;
+    tapi_walk_balances(&balance, &hold, fast_balance_row, d);
+    return 1;
+}
+
+typedef int (*parse_fn)(const char *json, size_t len, struct digest *d);
+
+static double run(parse_fn fn, const char *json, size_t len, int iterations, struct digest *d) {
+    double t0 = now_sec();
+    for (int i = 0; i < iterations; i++) {
+        memset(d, 0, sizeof(*d));
+        if (!fn(json, len, d)) return -1;
+    }
+    return (now_sec() - t0) / iterations;
+}
+
+static int compare(const char *name, parse_fn legacy, parse_fn fast, const char *json, size_t len, int iterations) {
+    struct digest a, b;
+    double ta = run(legacy, json, len, iterations, &a);
+    double tb = run(fast, json, len, iterations, &b);
+    if (ta < 0 || tb < 0) {
+        fprintf(stderr, "%s: parse failed\n", name);
+        return 0;
+    }
+    if (a.rows != b.rows || a.bytes != b.bytes || a.total != b.total) {
+        fprintf(stderr, "%s: paths disagree: rows %zu/%zu bytes %zu/%zu total %.8f/%.8f\n",
+                name, a.rows, b.rows, a.bytes, b.bytes, a.total, b.total);
+        return 0;
+    }
+
+    double mb = len / 1e6;
+    printf("%-10s %9zu bytes %7zu rows\n", name, len, a.rows);
+    printf("  %-20s %10.1f us/op %8.1f MB/s\n", "jansson", ta * 1e6, mb / ta);
+    printf("  %-20s %10.1f us/op %8.1f MB/s\n", "tapi_json", tb * 1e6, mb / tb);
+    printf("  speedup: %.2fx\n", ta / tb);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    int orders = 20000, assets = 500, iterations = 0;
+    const char *dir = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:a:i:r:")) != -1) {
+        switch (opt) {
+        case 'n': orders = atoi(optarg); break;
+        case 'a': assets = atoi(optarg); break;
+        case 'i': iterations = atoi(optarg); break;
+        case 'r': dir = optarg; break;
+        default:
+            fprintf(stderr, "Usage: %s [-n orders] [-a assets] [-i iterations] [-r dir]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    size_t orders_len, info_len;
+    char *orders_body = load_recorded(dir, "openOrders", &orders_len);
+    if (!orders_body) {
+        struct strbuf sb = {0};
+        make_orders(&sb, orders, NCOINS, 0);
+        orders_body = sb.data;
+        orders_len = sb.len;
+    }
+    char *info_body = load_recorded(dir, "getInfo", &info_len);
+    if (!info_body) {
+        struct strbuf sb = {0};
+        make_info(&sb, assets);
+        info_body = sb.data;
+        info_len = sb.len;
+    }
+
+    // Roughly 200 MB of input per path unless told otherwise
+    int orders_iter = iterations ? iterations : (int)(200e6 / orders_len) + 1;
+    int info_iter = iterations ? iterations : (int)(200e6 / info_len) + 1;
+
+    int ok = compare("openOrders", legacy_orders, fast_orders, orders_body, orders_len, orders_iter) &&
+             compare("getInfo", legacy_info, fast_info, info_body, info_len, info_iter);
+
+    free(orders_body);
+    free(info_body);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+// Compares the precomputed-key signer in sign.c against the original one-shot
+// HMAC() signing path. Refuses to report numbers unless both agree byte for byte.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
+#include "../sign.h"
+
+#define ITERATIONS 200000
+
+// The signing function as it was in main.c before sign.c existed
+static void legacy_hmac_sha512(const char *data, const char *key, char *out_hex) {
+    unsigned char *digest;
+    digest = HMAC(EVP_sha512(), key, strlen(key), (unsigned char*)data, strlen(data), NULL, NULL);
+    for (int i = 0; i < 64; i++) {
+        sprintf(&out_hex[i*2], "%02x", (unsigned int)digest[i]);
+    }
+}
+
+struct known_answer {
+    const char *key;
+    const char *data;
+    const char *expect;
+};
+
+// RFC 4231 test cases 2 and 6 (the latter has a key longer than one block)
+static const struct known_answer kats[] = {
+    { "Jefe", "what do ya want for nothing?",
+      "164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea250554"
+      "9758bf75c05a994a6d034f65f8f0e6fdcaeab1a34d4a6b4b636e070a38bce737" },
+    { NULL, "Test Using Larger Than Block-Size Key - Hash Key First",
+      "80b24263c7c1a3ebb71493c1dd7be8b49b46d1f41b4aeec1121b013783f8f352"
+      "6b56d037e05f2598bd0fd2215d6a1e5295e64f73f63f0aec8b915a985d786598" },
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int check_known_answers(void) {
+    char big_key[131];
+    memset(big_key, 0xaa, 131);
+
+    for (size_t i = 0; i < sizeof(kats) / sizeof(kats[0]); i++) {
+        const char *key = kats[i].key ? kats[i].key : big_key;
+        size_t key_len = kats[i].key ? strlen(key) : sizeof(big_key);
+        struct hmac_signer signer;
+        char out[SIGN_HEX_LEN + 1];
+
+        hmac_signer_init(&signer, key, key_len);
+        hmac_signer_sign(&signer, kats[i].data, strlen(kats[i].data), out);
+        if (strcmp(out, kats[i].expect) != 0) {
+            fprintf(stderr, "known answer %zu mismatch:\n  got  %s\n  want %s\n", i, out, kats[i].expect);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : ITERATIONS;
+    const char *secret = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+    const char *payload =
+        "method=trade&timestamp=1754452495000&recvWindow=1804352495000&pair=doge_idr"
+        "&type=buy&price=1500&idr=100000&client_order_id=dogeidr-1754452495-idX";
+    char legacy[SIGN_HEX_LEN + 1], fast[SIGN_HEX_LEN + 1];
+    struct hmac_signer signer;
+
+    if (!check_known_answers()) return 1;
+
+    hmac_signer_init(&signer, secret, strlen(secret));
+    legacy_hmac_sha512(payload, secret, legacy);
+    hmac_signer_sign(&signer, payload, strlen(payload), fast);
+    if (memcmp(legacy, fast, sizeof(fast)) != 0) {
+        fprintf(stderr, "signer output differs from legacy HMAC():\n  %s\n  %s\n", legacy, fast);
+        return 1;
+    }
+    printf("known answers and legacy comparison: OK\n");
+
+    double t0 = now_sec();
+    for (int i = 0; i < iterations; i++) {
+        legacy_hmac_sha512(payload, secret, legacy);
+    }
+    double t1 = now_sec();
+    for (int i = 0; i < iterations; i++) {
+        hmac_signer_sign(&signer, payload, strlen(payload), fast);
+    }
+    double t2 = now_sec();
+
+    double legacy_rate = iterations / (t1 - t0);
+    double fast_rate = iterations / (t2 - t1);
+    printf("%-22s %12.0f sig/s %8.0f ns/sig\n", "legacy hmac_sha512", legacy_rate, 1e9 / legacy_rate);
+    printf("%-22s %12.0f sig/s %8.0f ns/sig\n", "hmac_signer_sign", fast_rate, 1e9 / fast_rate);
+    printf("speedup: %.2fx\n", fast_rate / legacy_rate);
+    return 0;
+}
@@ -0,0 +1,249 @@
+// Cold- vs warm-start benchmark for one-shot runs. Each run is a fresh
+// indodax_api process doing sync-clock (one public GET over TLS); cold runs
+// delete the connection cache first, warm runs keep it, so warm runs reuse the
+// cached address and resume the previous process's TLS session.
+//
+//   start_bench [-c client] [-n runs] [-u base_url]
+//
+// Without -u a local `openssl s_server -WWW` with a throwaway certificate for
+// localhost stands in for the exchange; with -u the given host is measured.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <limits.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "../metrics.h"
+
+static char workdir[] = "/tmp/indodax_start.XXXXXX";
+static char client_path[PATH_MAX];
+
+struct start_result {
+    const char *name;
+    struct latency_hist wall;
+    struct latency_hist dns;
+    struct latency_hist connect;
+    struct latency_hist tls;
+    struct latency_hist total;
+    long runs;
+    long errors;
+};
+
+static pid_t spawn(char *const argv[], const char *dir, int err_fd) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (chdir(dir) != 0) _exit(127);
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        dup2(err_fd >= 0 ? err_fd : devnull, STDERR_FILENO);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    return pid;
+}
+
+static int free_port(void) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) != 0) {
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    return ntohs(addr.sin_port);
+}
+
+// Self-signed localhost certificate and a docroot serving /api/server_time.
+static pid_t start_tls_server(int port) {
+    char cmd[PATH_MAX * 2];
+    snprintf(cmd, sizeof(cmd),
+             "cd '%s' && mkdir -p www/api && "
+             "openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes -days 1 "
+             "-subj /CN=localhost -addext subjectAltName=DNS:localhost "
+             "-keyout key.pem -out cert.pem >/dev/null 2>&1 && "
+             "echo '{\"timezone\":\"UTC\",\"server_time\":1754452495000}' > www/api/server_time",
+             workdir);
+    if (system(cmd) != 0) return -1;
+
+    char dir[PATH_MAX], accept[16], cert[PATH_MAX], key[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/www", workdir);
+    snprintf(accept, sizeof(accept), "%d", port);
+    snprintf(cert, sizeof(cert), "%s/cert.pem", workdir);
+    snprintf(key, sizeof(key), "%s/key.pem", workdir);
+    char *argv[] = { "openssl", "s_server", "-WWW", "-quiet", "-accept", accept,
+                     "-cert", cert, "-key", key, NULL };
+    pid_t pid = spawn(argv, dir, -1);
+
+    // Ready once it accepts a connection
+    for (int i = 0; i < 200; i++) {
+        struct sockaddr_in addr;
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int ok = connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+        close(fd);
+        if (ok) return pid;
+        usleep(10000);
+    }
+    kill(pid, SIGTERM);
+    return -1;
+}
+
+static uint64_t json_field(const char *line, const char *name) {
+    char key[32];
+    snprintf(key, sizeof(key), "\"%s\":", name);
+    const char *p = strstr(line, key);
+    return p ? strtoull(p + strlen(key), NULL, 10) : 0;
+}
+
+// One client process; its --timings line on stderr gives the phase split.
+static void run_once(struct start_result *r) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        r->errors++;
+        return;
+    }
+
+    char *argv[] = { client_path, "sync-clock", "--timings", NULL };
+    uint64_t t0 = monotonic_us();
+    pid_t pid = spawn(argv, workdir, fds[1]);
+    close(fds[1]);
+
+    char buf[4096];
+    size_t len = 0;
+    ssize_t n;
+    while ((n = read(fds[0], buf + len, sizeof(buf) - 1 - len)) > 0) len += n;
+    buf[len] = '\0';
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    uint64_t wall = monotonic_us() - t0;
+    r->runs++;
+
+    const char *line = strstr(buf, "{\"method\"");
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || !line) {
+        r->errors++;
+        return;
+    }
+    hist_record(&r->wall, wall);
+    hist_record(&r->dns, json_field(line, "dns_us"));
+    hist_record(&r->connect, json_field(line, "connect_us"));
+    hist_record(&r->tls, json_field(line, "tls_us"));
+    hist_record(&r->total, json_field(line, "total_us"));
+}
+
+static void run_mode(struct start_result *r, int runs, int cold) {
+    char cache[PATH_MAX];
+    snprintf(cache, sizeof(cache), "%s/indodax_conn.cache", workdir);
+
+    // Warm runs start from a cache an earlier process left behind
+    if (!cold) {
+        struct start_result prime;
+        memset(&prime, 0, sizeof(prime));
+        unlink(cache);
+        run_once(&prime);
+    }
+    for (int i = 0; i < runs; i++) {
+        if (cold) unlink(cache);
+        run_once(r);
+    }
+}
+
+static void print_result(const struct start_result *r) {
+    printf("| %-6s | %6ld | %6ld | %9.3f | %9.3f | %9.3f | %9.3f | %9.3f | %9.3f |\n", r->name, r->runs, r->errors,
+           hist_percentile(&r->wall, 50.0) / 1000.0,
+           hist_percentile(&r->wall, 90.0) / 1000.0,
+           hist_percentile(&r->dns, 50.0) / 1000.0,
+           hist_percentile(&r->connect, 50.0) / 1000.0,
+           hist_percentile(&r->tls, 50.0) / 1000.0,
+           hist_percentile(&r->total, 50.0) / 1000.0);
+}
+
+int main(int argc, char *argv[]) {
+    const char *client = "./indodax_api";
+    const char *base_url = NULL;
+    int runs = 50;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:n:u:")) != -1) {
+        switch (opt) {
+        case 'c': client = optarg; break;
+        case 'n': runs = atoi(optarg); break;
+        case 'u': base_url = optarg; break;
+        default:
+            fprintf(stderr, "Usage: %s [-c client] [-n runs] [-u base_url]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!realpath(client, client_path)) {
+        fprintf(stderr, "Cannot find %s, run make first\n", client);
+        return 1;
+    }
+    if (!mkdtemp(workdir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    pid_t server_pid = -1;
+    char url[PATH_MAX];
+    if (base_url) {
+        snprintf(url, sizeof(url), "%s", base_url);
+    } else {
+        int port = free_port();
+        server_pid = port > 0 ? start_tls_server(port) : -1;
+        if (server_pid < 0) {
+            fprintf(stderr, "local TLS server failed to start (is the openssl command installed?)\n");
+            return 1;
+        }
+        snprintf(url, sizeof(url), "https://localhost:%d", port);
+    }
+    unsetenv("INDODAX_BASE_URL");
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/indodax_config.txt", workdir);
+    FILE *f = fopen(path, "w");
+    fprintf(f, "key=benchkey\nsecret=benchsecret\nbase_url=%s\n", url);
+    if (!base_url) fprintf(f, "ca_file=%s/cert.pem\n", workdir);
+    fclose(f);
+
+    printf("%d one-shot sync-clock runs per mode against %s\n\n", runs, url);
+
+    struct start_result results[2];
+    memset(results, 0, sizeof(results));
+    results[0].name = "cold";
+    run_mode(&results[0], runs, 1);
+    results[1].name = "warm";
+    run_mode(&results[1], runs, 0);
+
+    printf("+--------+--------+--------+-----------+-----------+-----------+-----------+-----------+-----------+\n");
+    printf("| Start  | Runs   | Errors | p50 ms    | p90 ms    | DNS ms    | TCP ms    | TLS ms    | HTTP ms   |\n");
+    printf("+--------+--------+--------+-----------+-----------+-----------+-----------+-----------+-----------+\n");
+    print_result(&results[0]);
+    print_result(&results[1]);
+    printf("+--------+--------+--------+-----------+-----------+-----------+-----------+-----------+-----------+\n");
+    printf("p50/p90 are process wall time; phase columns are p50 from --timings\n");
+
+    if (server_pid > 0) {
+        kill(server_pid, SIGTERM);
+        waitpid(server_pid, NULL, 0);
+    }
+    snprintf(path, sizeof(path), "rm -rf '%s'", workdir);
+    if (system(path) != 0) fprintf(stderr, "could not remove %s\n", workdir);
+
+    return results[0].errors + results[1].errors ? 1 : 0;
+}
@@ -0,0 +1,252 @@
+// End-to-end client benchmark against bench/mock_tapi. Runs the real
+// indodax_api binary one-shot, through a serve daemon, and in batch mode,
+// and reports requests/sec and latency percentiles for each.
+//
+//   tapi_bench [-c client] [-m mock] [-n requests] [-o orders] [-a assets] [-d delay_us] [-b batch] [-j inflight]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "../metrics.h"
+
+static char workdir[] = "/tmp/indodax_bench.XXXXXX";
+static char client_path[PATH_MAX];
+static char socket_file[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+struct scenario_result {
+    const char *name;
+    struct latency_hist hist;
+    uint64_t wall_us;
+    long requests;
+    long errors;
+};
+
+static pid_t spawn(char *const argv[], int out_fd) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (chdir(workdir) != 0) _exit(127);
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(out_fd >= 0 ? out_fd : devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    return pid;
+}
+
+static int run_client(char *const argv[]) {
+    int status = 0;
+    pid_t pid = spawn(argv, -1);
+    if (pid < 0) return 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static pid_t start_mock(const char *mock, const char *orders, const char *assets, const char *delay, int *port) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+
+    char *argv[] = { (char *)mock, "-p", "0", "-k", "benchkey", "-s", "benchsecret",
+                     "-n", (char *)orders, "-a", (char *)assets, "-d", (char *)delay, NULL };
+    pid_t pid = spawn(argv, fds[1]);
+    close(fds[1]);
+
+    char line[64] = {0};
+    ssize_t n = read(fds[0], line, sizeof(line) - 1);
+    close(fds[0]);
+    if (n <= 0 || sscanf(line, "port %d", port) != 1) {
+        kill(pid, SIGTERM);
+        return -1;
+    }
+    return pid;
+}
+
+static void oneshot(struct scenario_result *r, char *args[], int n) {
+    uint64_t start = monotonic_us();
+    for (int i = 0; i < n; i++) {
+        uint64_t t0 = monotonic_us();
+        if (!run_client(args)) r->errors++;
+        hist_record(&r->hist, monotonic_us() - t0);
+        r->requests++;
+    }
+    r->wall_us = monotonic_us() - start;
+}
+
+// Speaks the serve protocol directly so only the daemon's latency is measured.
+static int remote_call(const char *const args[]) {
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_file);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return 0;
+    }
+
+    for (int i = 0; args[i]; i++) {
+        if (write(fd, args[i], strlen(args[i]) + 1) < 0) break;
+    }
+    shutdown(fd, SHUT_WR);
+
+    char buf[65536];
+    ssize_t n;
+    int ok = 1;
+    while ((n = read(fd, buf, sizeof(buf) - 1)) > 0) {
+        buf[n] = '\0';
+        if (strstr(buf, "API Error") || strstr(buf, "CURL error")) ok = 0;
+    }
+    close(fd);
+    return ok;
+}
+
+static void served(struct scenario_result *r, const char *const args[], int n) {
+    uint64_t start = monotonic_us();
+    for (int i = 0; i < n; i++) {
+        uint64_t t0 = monotonic_us();
+        if (!remote_call(args)) r->errors++;
+        hist_record(&r->hist, monotonic_us() - t0);
+        r->requests++;
+    }
+    r->wall_us = monotonic_us() - start;
+}
+
+static void batch(struct scenario_result *r, int orders, const char *inflight) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/orders.txt", workdir);
+    FILE *f = fopen(path, "w");
+    for (int i = 0; i < orders; i++) {
+        // On-tick and above the minimum, so every order passes the pair checks
+        if (i % 2) fprintf(f, "btc sell %d 0.1\n", 1000000 + i * 1000);
+        else fprintf(f, "btc buy %d 100000\n", 1000000 + i * 1000);
+    }
+    fclose(f);
+
+    char *args[] = { client_path, "batch", path, (char *)inflight, NULL };
+    uint64_t t0 = monotonic_us();
+    if (!run_client(args)) r->errors++;
+    r->wall_us = monotonic_us() - t0;
+    r->requests = orders;
+    hist_record(&r->hist, r->wall_us / (orders ? orders : 1));
+}
+
+static void print_result(const struct scenario_result *r) {
+    double rps = r->wall_us ? r->requests * 1e6 / r->wall_us : 0;
+    printf("| %-22s | %8ld | %6ld | %10.1f | %9.3f | %9.3f | %9.3f |\n", r->name, r->requests, r->errors, rps,
+           hist_percentile(&r->hist, 50.0) / 1000.0,
+           hist_percentile(&r->hist, 99.0) / 1000.0,
+           hist_percentile(&r->hist, 99.9) / 1000.0);
+}
+
+int main(int argc, char *argv[]) {
+    const char *client = "./indodax_api";
+    const char *mock = "./bench/mock_tapi";
+    const char *orders = "100", *assets = "20", *delay = "0", *inflight = "16";
+    int n = 200, batch_orders = 1000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:m:n:o:a:d:b:j:")) != -1) {
+        switch (opt) {
+        case 'c': client = optarg; break;
+        case 'm': mock = optarg; break;
+        case 'n': n = atoi(optarg); break;
+        case 'o': orders = optarg; break;
+        case 'a': assets = optarg; break;
+        case 'd': delay = optarg; break;
+        case 'b': batch_orders = atoi(optarg); break;
+        case 'j': inflight = optarg; break;
+        default:
+            fprintf(stderr, "Usage: %s [-c client] [-m mock] [-n requests] [-o orders] [-a assets] [-d delay_us] [-b batch] [-j inflight]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    char mock_path[PATH_MAX];
+    if (!realpath(client, client_path) || !realpath(mock, mock_path)) {
+        fprintf(stderr, "Cannot find %s or %s, run make first\n", client, mock);
+        return 1;
+    }
+    if (!mkdtemp(workdir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/indodax_config.txt", workdir);
+    FILE *f = fopen(path, "w");
+    // Rate limits off: the bench measures the client, not the exchange's budget
+    fprintf(f, "key=benchkey\nsecret=benchsecret\nrate_cancel=0\nrate_trade=0\nrate_read=0\n");
+    fclose(f);
+
+    int port;
+    pid_t mock_pid = start_mock(mock_path, orders, assets, delay, &port);
+    if (mock_pid < 0) {
+        fprintf(stderr, "mock server failed to start\n");
+        return 1;
+    }
+
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d", port);
+    snprintf(socket_file, sizeof(socket_file), "%s/serve.sock", workdir);
+    setenv("INDODAX_BASE_URL", url, 1);
+    setenv("INDODAX_SOCKET", socket_file, 1);
+
+    printf("mock /tapi on %s: %s orders, %s assets, %s us server delay\n\n", url, orders, assets, delay);
+
+    struct scenario_result results[7];
+    memset(results, 0, sizeof(results));
+    int nres = 0;
+
+    char *open_args[] = { client_path, "open", NULL };
+    char *info_args[] = { client_path, "getInfo", NULL };
+    char *buy_args[] = { client_path, "buy", "btc", "1000000", "100000", NULL };
+    results[nres].name = "one-shot open";
+    oneshot(&results[nres++], open_args, n);
+    results[nres].name = "one-shot getInfo";
+    oneshot(&results[nres++], info_args, n);
+    results[nres].name = "one-shot buy";
+    oneshot(&results[nres++], buy_args, n);
+
+    char *serve_args[] = { client_path, "serve", socket_file, NULL };
+    pid_t serve_pid = spawn(serve_args, -1);
+    struct stat st;
+    for (int i = 0; i < 200 && stat(socket_file, &st) != 0; i++) usleep(10000);
+
+    const char *r_open[] = { "open", NULL };
+    const char *r_info[] = { "getInfo", NULL };
+    const char *r_buy[] = { "buy", "btc", "1000000", "100000", NULL };
+    results[nres].name = "serve open";
+    served(&results[nres++], r_open, n);
+    results[nres].name = "serve getInfo";
+    served(&results[nres++], r_info, n);
+    results[nres].name = "serve buy";
+    served(&results[nres++], r_buy, n);
+    kill(serve_pid, SIGTERM);
+    waitpid(serve_pid, NULL, 0);
+
+    results[nres].name = "batch trade";
+    batch(&results[nres++], batch_orders, inflight);
+
+    printf("+------------------------+----------+--------+------------+-----------+-----------+-----------+\n");
+    printf("| Scenario               | Requests | Errors | Req/s      | p50 ms    | p99 ms    | p999 ms   |\n");
+    printf("+------------------------+----------+--------+------------+-----------+-----------+-----------+\n");
+    for (int i = 0; i < nres; i++) print_result(&results[i]);
+    printf("+------------------------+----------+--------+------------+-----------+-----------+-----------+\n");
+    printf("batch latency columns are wall time / orders\n");
+
+    kill(mock_pid, SIGTERM);
+    waitpid(mock_pid, NULL, 0);
+    snprintf(path, sizeof(path), "rm -rf '%s'", workdir);
+    if (system(path) != 0) fprintf(stderr, "could not remove %s\n", workdir);
+
+    int errors = 0;
+    for (int i = 0; i < nres; i++) errors += results[i].errors;
+    return errors ? 1 : 0;
+}
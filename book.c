@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tapi_json.h"
+#include "book.h"
+
+static int cmp_desc(const void *a, const void *b) {
+    dec64 pa = ((const struct book_level *)a)->price, pb = ((const struct book_level *)b)->price;
+    return (pa < pb) - (pa > pb);
+}
+
+static int cmp_asc(const void *a, const void *b) {
+    dec64 pa = ((const struct book_level *)a)->price, pb = ((const struct book_level *)b)->price;
+    return (pa > pb) - (pa < pb);
+}
+
+// Refills one side in place. The exchange already sends sorted levels, so the
+// sort is skipped unless an out-of-order level is actually seen.
+static int load_side(const struct json_view *side, struct book_level **levels, size_t *n, size_t *cap, int descending) {
+    if (side->kind != JV_ARRAY) return 0;
+
+    size_t used = 0;
+    int sorted = 1;
+    struct json_iter it, fields;
+    struct json_view entry, price, amount;
+    jv_iter_init(&it, side);
+    while (jv_array_next(&it, &entry) > 0) {
+        if (entry.kind != JV_ARRAY) continue;
+        jv_iter_init(&fields, &entry);
+        if (jv_array_next(&fields, &price) <= 0 || jv_array_next(&fields, &amount) <= 0) continue;
+
+        if (used == *cap) {
+            size_t grown = *cap ? *cap * 2 : 64;
+            struct book_level *tmp = realloc(*levels, grown * sizeof(**levels));
+            if (!tmp) return 0;
+            *levels = tmp;
+            *cap = grown;
+        }
+        struct book_level *l = &(*levels)[used];
+        l->price = jv_dec(&price);
+        l->amount = jv_dec(&amount);
+        if (used > 0 && (descending ? l->price > l[-1].price : l->price < l[-1].price)) sorted = 0;
+        used++;
+    }
+
+    if (!sorted) qsort(*levels, used, sizeof(**levels), descending ? cmp_desc : cmp_asc);
+    *n = used;
+    return 1;
+}
+
+static dec64 min_gap(const struct book_level *levels, size_t n, dec64 best) {
+    for (size_t i = 1; i < n; i++) {
+        dec64 gap = levels[i - 1].price - levels[i].price;
+        if (gap < 0) gap = -gap;
+        if (gap > 0 && (best == 0 || gap < best)) best = gap;
+    }
+    return best;
+}
+
+// Loads a /api/depth/<pair> snapshot: {"buy":[[price,amount],...],"sell":[...]}.
+int book_load_depth(struct order_book *book, const char *json, size_t len) {
+    struct json_view root, err, buy, sell;
+    size_t offset;
+    if (!jv_parse(json, len, &root, &offset) || root.kind != JV_OBJECT) {
+        fprintf(stderr, "JSON error: invalid JSON near offset %zu\n", offset);
+        return 0;
+    }
+
+    if (jv_object_get(&root, "error", &err) && err.kind == JV_STRING) {
+        char msg[128];
+        fprintf(stderr, "API Error: %s\n", jv_copy(err.text, msg, sizeof(msg)));
+        return 0;
+    }
+
+    if (!jv_object_get(&root, "buy", &buy) || !jv_object_get(&root, "sell", &sell) ||
+        !load_side(&buy, &book->bids, &book->nbids, &book->cap_bids, 1) ||
+        !load_side(&sell, &book->asks, &book->nasks, &book->cap_asks, 0)) {
+        fprintf(stderr, "Unexpected depth format\n");
+        return 0;
+    }
+
+    book->tick = min_gap(book->asks, book->nasks, min_gap(book->bids, book->nbids, 0));
+    return 1;
+}
+
+// Loads /api/trades/<pair>; only the most recent price is kept.
+int book_load_trades(struct order_book *book, const char *json, size_t len) {
+    struct json_view root, trade, price;
+    size_t offset;
+    if (!jv_parse(json, len, &root, &offset)) {
+        fprintf(stderr, "JSON error: invalid JSON near offset %zu\n", offset);
+        return 0;
+    }
+
+    struct json_iter it;
+    if (root.kind == JV_ARRAY) {
+        jv_iter_init(&it, &root);
+        if (jv_array_next(&it, &trade) > 0 && trade.kind == JV_OBJECT && jv_object_get(&trade, "price", &price)) {
+            book->last_price = jv_dec(&price);
+        }
+    }
+    return 1;
+}
+
+void book_free(struct order_book *book) {
+    free(book->bids);
+    free(book->asks);
+    memset(book, 0, sizeof(*book));
+}
+
+// Average price paid (buy, walking asks) or received (sell, walking bids) for
+// size units. *filled is less than size when the book is too thin.
+dec64 book_vwap(const struct order_book *book, int buy, dec64 size, dec64 *filled) {
+    const struct book_level *levels = buy ? book->asks : book->bids;
+    size_t n = buy ? book->nasks : book->nbids;
+    dec128 notional = 0;
+    dec64 remaining = size;
+
+    for (size_t i = 0; i < n && remaining > 0; i++) {
+        dec64 take = levels[i].amount < remaining ? levels[i].amount : remaining;
+        notional += (dec128)take * levels[i].price;
+        remaining -= take;
+    }
+
+    *filled = size - remaining;
+    return *filled ? (dec64)(notional / *filled) : 0;
+}
+
+void book_print(const struct order_book *book, size_t levels) {
+    char p[32], a[32], q[32], r[32];
+
+    printf("+-------------------+-------------------+-------------------+-------------------+\n");
+    printf("| Bid Amount        | Bid Price         | Ask Price         | Ask Amount        |\n");
+    printf("+-------------------+-------------------+-------------------+-------------------+\n");
+    for (size_t i = 0; i < levels && (i < book->nbids || i < book->nasks); i++) {
+        const struct book_level *bid = i < book->nbids ? &book->bids[i] : NULL;
+        const struct book_level *ask = i < book->nasks ? &book->asks[i] : NULL;
+        printf("| %17s | %17s | %-17s | %-17s |\n",
+               bid ? dec_format(bid->amount, a, sizeof(a)) : "",
+               bid ? dec_format(bid->price, p, sizeof(p)) : "",
+               ask ? dec_format(ask->price, q, sizeof(q)) : "",
+               ask ? dec_format(ask->amount, r, sizeof(r)) : "");
+    }
+    printf("+-------------------+-------------------+-------------------+-------------------+\n");
+
+    const struct book_level *bid = book_best_bid(book), *ask = book_best_ask(book);
+    if (bid && ask) {
+        printf("Spread: %s  Mid: %s", dec_format(ask->price - bid->price, p, sizeof(p)),
+               dec_format((ask->price + bid->price) / 2, q, sizeof(q)));
+        if (book->tick) printf("  Tick: %s", dec_format(book->tick, a, sizeof(a)));
+        if (book->last_price) printf("  Last: %s", dec_format(book->last_price, r, sizeof(r)));
+        printf("\n");
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "decimal.h"
+
+struct book_level {
+    dec64 price;
+    dec64 amount;
+};
+
+// Bids are sorted best (highest) first and asks best (lowest) first, so the
+// top of book is element 0 and top-N is a prefix of each array.
+struct order_book {
+    char pair[32];
+    struct book_level *bids;
+    struct book_level *asks;
+    size_t nbids, nasks;
+    size_t cap_bids, cap_asks;
+    dec64 last_price;       // 0 until trades are loaded
+    dec64 tick;             // the pair's tick when known, else the smallest gap seen; 0 if unknown
+};
+
+int book_load_depth(struct order_book *book, const char *json, size_t len);
+int book_load_trades(struct order_book *book, const char *json, size_t len);
+void book_free(struct order_book *book);
+
+static inline const struct book_level *book_best_bid(const struct order_book *book) {
+    return book->nbids ? &book->bids[0] : NULL;
+}
+
+static inline const struct book_level *book_best_ask(const struct order_book *book) {
+    return book->nasks ? &book->asks[0] : NULL;
+}
+
+dec64 book_vwap(const struct order_book *book, int buy, dec64 size, dec64 *filled);
+void book_print(const struct order_book *book, size_t levels);
+
+#endif
@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <openssl/ssl.h>
+#include "conn_cache.h"
+
+typedef int (*new_session_fn)(SSL *ssl, SSL_SESSION *session);
+typedef void (*info_fn)(const SSL *ssl, int where, int ret);
+
+static struct {
+    int open;
+    int dirty;
+    char path[256];
+    struct conn_settings settings;
+    struct conn_cache_file file;
+    CURLSH *share;
+    struct curl_slist *resolve;         // non-NULL when the cached address is in use
+    SSL_SESSION *session;               // loaded from the file, offered on first handshake
+    new_session_fn curl_new_session;    // libcurl's own callback, chained
+    info_fn prev_info;
+} conn;
+
+static int url_host_port(const char *url, char *host, size_t size, long *port) {
+    CURLU *u = curl_url();
+    char *h = NULL, *p = NULL;
+    int ok = u && curl_url_set(u, CURLUPART_URL, url, 0) == CURLUE_OK &&
+             curl_url_get(u, CURLUPART_HOST, &h, 0) == CURLUE_OK &&
+             curl_url_get(u, CURLUPART_PORT, &p, CURLU_DEFAULT_PORT) == CURLUE_OK;
+    if (ok) {
+        snprintf(host, size, "%s", h);
+        *port = strtol(p, NULL, 10);
+    }
+    curl_free(h);
+    curl_free(p);
+    curl_url_cleanup(u);
+    return ok;
+}
+
+static int load_file(const char *path, struct conn_cache_file *f) {
+    FILE *in = fopen(path, "rb");
+    if (!in) return 0;
+    int ok = fread(f, sizeof(*f), 1, in) == 1 && f->magic == CONN_CACHE_MAGIC &&
+             f->version == CONN_CACHE_VERSION && f->session_len <= CONN_SESSION_MAX;
+    fclose(in);
+    return ok;
+}
+
+// Reads the cache and prepares the resolve entry and session it offers.
+// Anything missing, stale or for another host is simply not used.
+int conn_cache_open(const char *path, const struct conn_settings *settings) {
+    char host[sizeof(conn.file.host)];
+    long port = 0;
+
+    memset(&conn, 0, sizeof(conn));
+    snprintf(conn.path, sizeof(conn.path), "%s", path);
+    conn.settings = *settings;
+    if (!url_host_port(settings->url, host, sizeof(host), &port)) return 0;
+
+    conn.share = curl_share_init();
+    if (conn.share) {
+        curl_share_setopt(conn.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(conn.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    if (!load_file(path, &conn.file) || strcmp(conn.file.host, host) != 0 || conn.file.port != port) {
+        memset(&conn.file, 0, sizeof(conn.file));
+        conn.file.magic = CONN_CACHE_MAGIC;
+        conn.file.version = CONN_CACHE_VERSION;
+        snprintf(conn.file.host, sizeof(conn.file.host), "%s", host);
+        conn.file.port = (int32_t)port;
+    }
+    conn.open = 1;
+
+    time_t now = time(NULL);
+    if (settings->dns_ttl > 0 && conn.file.resolved_at > 0 && conn.file.addr[0] &&
+        now - conn.file.resolved_at < settings->dns_ttl) {
+        char entry[sizeof(conn.file.host) + sizeof(conn.file.addr) + 16];
+        int v6 = strchr(conn.file.addr, ':') != NULL;
+        snprintf(entry, sizeof(entry), "%s:%d:%s%s%s", conn.file.host, conn.file.port,
+                 v6 ? "[" : "", conn.file.addr, v6 ? "]" : "");
+        conn.resolve = curl_slist_append(NULL, entry);
+    }
+
+    // Opting out also forgets whatever an earlier run left on disk
+    if (!settings->tls_resume && conn.file.session_len > 0) {
+        memset(conn.file.session, 0, sizeof(conn.file.session));
+        conn.file.session_len = 0;
+        conn.dirty = 1;
+    }
+    if (settings->tls_resume && conn.file.session_len > 0) {
+        const unsigned char *p = conn.file.session;
+        SSL_SESSION *s = d2i_SSL_SESSION(NULL, &p, conn.file.session_len);
+        if (s && SSL_SESSION_is_resumable(s) &&
+            (time_t)(SSL_SESSION_get_time(s) + SSL_SESSION_get_timeout(s)) > now) {
+            conn.session = s;
+        } else {
+            SSL_SESSION_free(s);
+        }
+    }
+    return 1;
+}
+
+// Every new session the server hands us replaces the one on disk; libcurl
+// still gets it for its in-process cache.
+static int save_session(SSL *ssl, SSL_SESSION *session) {
+    int len = i2d_SSL_SESSION(session, NULL);
+    if (len > 0 && len <= CONN_SESSION_MAX) {
+        unsigned char *p = conn.file.session;
+        i2d_SSL_SESSION(session, &p);
+        conn.file.session_len = (uint32_t)len;
+        conn.file.session_at = time(NULL);
+        conn.dirty = 1;
+    }
+    return conn.curl_new_session ? conn.curl_new_session(ssl, session) : 0;
+}
+
+// Runs inside SSL_connect before the ClientHello is built: if libcurl had no
+// session of its own to offer, offer the one the previous process saved.
+static void offer_session(const SSL *cssl, int where, int ret) {
+    if (conn.prev_info) conn.prev_info(cssl, where, ret);
+    if (!(where & SSL_CB_HANDSHAKE_START) || !conn.session) return;
+
+    SSL *ssl = (SSL *)cssl;
+    const char *sni = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (SSL_get0_session(ssl) || !sni || strcasecmp(sni, conn.file.host) != 0) return;
+    SSL_set_session(ssl, conn.session);
+}
+
+static CURLcode ssl_ctx_hook(CURL *curl, void *sslctx, void *arg) {
+    SSL_CTX *ctx = sslctx;
+    (void)curl;
+    (void)arg;
+
+    new_session_fn current = SSL_CTX_sess_get_new_cb(ctx);
+    if (current != save_session) conn.curl_new_session = current;
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL);
+    SSL_CTX_sess_set_new_cb(ctx, save_session);
+
+    if (conn.session) {
+        info_fn info = SSL_CTX_get_info_callback(ctx);
+        if (info != offer_session) conn.prev_info = info;
+        SSL_CTX_set_info_callback(ctx, offer_session);
+    }
+    return CURLE_OK;
+}
+
+void conn_cache_setup(CURL *easy) {
+    if (!conn.open) return;
+    if (conn.share) curl_easy_setopt(easy, CURLOPT_SHARE, conn.share);
+    if (conn.resolve) curl_easy_setopt(easy, CURLOPT_RESOLVE, conn.resolve);
+    if (conn.settings.ca_file) curl_easy_setopt(easy, CURLOPT_CAINFO, conn.settings.ca_file);
+    // Only OpenSSL builds of libcurl take this; others just skip resumption
+    if (conn.settings.tls_resume) curl_easy_setopt(easy, CURLOPT_SSL_CTX_FUNCTION, ssl_ctx_hook);
+}
+
+// Records the address a finished transfer actually connected to. An address
+// that came from the cache is not re-stamped, so it still expires; one that
+// stopped accepting connections is dropped for the next run.
+void conn_cache_note(CURL *easy, CURLcode result) {
+    if (!conn.open) return;
+
+    if (result == CURLE_COULDNT_CONNECT && conn.resolve && conn.file.resolved_at) {
+        conn.file.resolved_at = 0;
+        conn.dirty = 1;
+        return;
+    }
+    if (result != CURLE_OK || conn.resolve || conn.settings.dns_ttl <= 0) return;
+
+    char *ip = NULL;
+    long port = 0;
+    curl_easy_getinfo(easy, CURLINFO_PRIMARY_IP, &ip);
+    curl_easy_getinfo(easy, CURLINFO_PRIMARY_PORT, &port);
+    if (!ip || !*ip || port != conn.file.port) return;
+    if (strcmp(conn.file.addr, ip) == 0 && time(NULL) - conn.file.resolved_at < conn.settings.dns_ttl) return;
+
+    snprintf(conn.file.addr, sizeof(conn.file.addr), "%s", ip);
+    conn.file.resolved_at = time(NULL);
+    conn.dirty = 1;
+}
+
+// Writes the cache back if anything changed, through a temporary file renamed
+// into place, and releases the share. Call after every handle is cleaned up.
+void conn_cache_close(void) {
+    if (!conn.open) return;
+
+    if (conn.dirty) {
+        char tmp[sizeof(conn.path) + 16];
+        snprintf(tmp, sizeof(tmp), "%s.%ld", conn.path, (long)getpid());
+        int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd >= 0) {
+            int ok = write(fd, &conn.file, sizeof(conn.file)) == (ssize_t)sizeof(conn.file);
+            if (close(fd) != 0 || !ok || rename(tmp, conn.path) != 0) unlink(tmp);
+        }
+    }
+
+    if (conn.share) curl_share_cleanup(conn.share);
+    curl_slist_free_all(conn.resolve);
+    SSL_SESSION_free(conn.session);
+    memset(&conn, 0, sizeof(conn));
+}
@@ -0,0 +1,42 @@
+#ifndef CONN_CACHE_H
+#define CONN_CACHE_H
+
+#include <stdint.h>
+#include <curl/curl.h>
+
+#define CONN_CACHE_PATH "indodax_conn.cache"
+#define CONN_CACHE_MAGIC 0x4e584449u    // "IDXN"
+#define CONN_CACHE_VERSION 1
+#define CONN_SESSION_MAX 4096
+#define DNS_TTL 300
+
+struct conn_settings {
+    const char *url;            // base URL; its host and port key the cache
+    int dns_ttl;                // seconds a resolved address is reused, 0 disables
+    int tls_resume;             // persist the TLS session for the next process
+    const char *ca_file;        // CA bundle override, NULL for libcurl's default
+};
+
+// What one process leaves behind for the next: the address it connected to
+// and the last TLS session the server issued, as DER. The file is 0600 since
+// the session holds resumption secrets.
+struct conn_cache_file {
+    uint32_t magic;
+    uint32_t version;
+    char host[128];
+    int32_t port;
+    uint32_t session_len;
+    char addr[64];              // numeric, as CURLINFO_PRIMARY_IP reports it
+    int64_t resolved_at;        // 0 when no address is cached
+    int64_t session_at;
+    unsigned char session[CONN_SESSION_MAX];
+};
+
+// Process-wide, like the clock offset: every handle this process creates goes
+// through conn_cache_setup so they share one DNS and TLS session cache.
+int conn_cache_open(const char *path, const struct conn_settings *settings);
+void conn_cache_setup(CURL *easy);
+void conn_cache_note(CURL *easy, CURLcode result);
+void conn_cache_close(void);
+
+#endif
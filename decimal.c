@@ -0,0 +1,110 @@
+#include <string.h>
+#include "decimal.h"
+
+// Mantissa digits beyond this are dropped; 10^36 still leaves room in 128 bits.
+#define MANTISSA_LIMIT ((unsigned __int128)1000000000000000000ULL * 1000000000000000000ULL)
+
+// Parses "123", "-0.00012345", "1.5e-3" into 8-decimal fixed point, rounding
+// half away from zero past the 8th decimal. No locale, no libc conversion.
+// Returns 0 for anything that is not entirely a number or does not fit.
+int dec_parse(const char *s, size_t len, dec64 *out) {
+    const char *p = s, *end = s + len;
+    unsigned __int128 mant = 0;
+    int exp = 0, digits = 0, neg = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+        if (mant < MANTISSA_LIMIT) mant = mant * 10 + (*p - '0');
+        else exp++;
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+            if (mant < MANTISSA_LIMIT) {
+                mant = mant * 10 + (*p - '0');
+                exp--;
+            }
+        }
+    }
+    if (!digits) return 0;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        int eneg = 0, e = 0, edigits = 0;
+        p++;
+        if (p < end && (*p == '-' || *p == '+')) eneg = *p++ == '-';
+        for (; p < end && *p >= '0' && *p <= '9'; p++, edigits++) {
+            if (e < 10000) e = e * 10 + (*p - '0');
+        }
+        if (!edigits) return 0;
+        exp += eneg ? -e : e;
+    }
+    if (p != end) return 0;
+
+    // value = mant * 10^exp, wanted: round(value * 10^8)
+    int shift = exp + DEC_DECIMALS;
+    if (shift > 0) {
+        for (; shift > 0 && mant; shift--) {
+            mant *= 10;
+            if (mant > INT64_MAX) return 0;
+        }
+    } else if (shift < 0) {
+        unsigned __int128 div = 1;
+        for (; shift < 0 && div <= mant; shift++) div *= 10;
+        mant = shift < 0 ? 0 : (mant + div / 2) / div;
+    }
+    if (mant > INT64_MAX) return 0;
+
+    *out = neg ? -(dec64)mant : (dec64)mant;
+    return 1;
+}
+
+// Lenient form for NUL-terminated input: leading blanks are skipped and
+// anything unparsable reads as zero.
+dec64 dec_from_str(const char *s) {
+    dec64 v;
+    while (*s == ' ') s++;
+    return dec_parse(s, strlen(s), &v) ? v : 0;
+}
+
+// Writes v with trailing fractional zeros (and a bare point) trimmed, the way
+// balances have always been shown: 1.5, 0.00012345, 42.
+static char *format_magnitude(unsigned __int128 u, int neg, char *buf, size_t size) {
+    char tmp[DEC_STRLEN];
+    char *p = tmp + sizeof(tmp);
+    unsigned __int128 whole = u / DEC_SCALE;
+    uint64_t frac = (uint64_t)(u % DEC_SCALE);
+
+    if (frac) {
+        int n = DEC_DECIMALS;
+        while (frac % 10 == 0) {
+            frac /= 10;
+            n--;
+        }
+        while (n-- > 0) {
+            *--p = (char)('0' + frac % 10);
+            frac /= 10;
+        }
+        *--p = '.';
+    }
+    do {
+        *--p = (char)('0' + (int)(whole % 10));
+        whole /= 10;
+    } while (whole);
+    if (neg) *--p = '-';
+
+    size_t len = tmp + sizeof(tmp) - p;
+    if (size == 0) return buf;
+    if (len >= size) len = size - 1;
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+    return buf;
+}
+
+char *dec_format(dec64 v, char *buf, size_t size) {
+    unsigned __int128 u = v < 0 ? -(unsigned __int128)(__int128)v : (unsigned __int128)v;
+    return format_magnitude(u, v < 0, buf, size);
+}
+
+char *dec128_format(dec128 v, char *buf, size_t size) {
+    unsigned __int128 u = v < 0 ? -(unsigned __int128)v : (unsigned __int128)v;
+    return format_magnitude(u, v < 0, buf, size);
+}
@@ -0,0 +1,32 @@
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Prices, amounts and balances as fixed point with 8 decimals, the exchange's
+// precision. int64 holds +-92 billion at that scale, enough for any single
+// IDR price or coin amount; sums and products go through 128 bits.
+#define DEC_SCALE 100000000LL
+#define DEC_DECIMALS 8
+#define DEC_STRLEN 48           // fits any dec128 with sign and point
+
+typedef int64_t dec64;
+typedef __int128 dec128;
+
+int dec_parse(const char *s, size_t len, dec64 *out);
+dec64 dec_from_str(const char *s);
+char *dec_format(dec64 v, char *buf, size_t size);
+char *dec128_format(dec128 v, char *buf, size_t size);
+
+static inline dec64 dec_from_int(int64_t v) {
+    return v * DEC_SCALE;
+}
+
+// a * b rounded half away from zero
+static inline dec64 dec_mul(dec64 a, dec64 b) {
+    dec128 p = (dec128)a * b;
+    return (dec64)((p + (p < 0 ? -DEC_SCALE / 2 : DEC_SCALE / 2)) / DEC_SCALE);
+}
+
+#endif
@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "format.h"
+
+char* extract_coin_name(const char *coin_pair) {
+    if (!coin_pair) return strdup("N/A");
+    
+    const char *underscore = strchr(coin_pair, '_');
+    if (underscore && (strcmp(underscore, "_idr") == 0)) {
+        size_t len = underscore - coin_pair;
+        char *coin_name = malloc(len + 1);
+        if (coin_name) {
+            strncpy(coin_name, coin_pair, len);
+            coin_name[len] = '\0';
+            return coin_name;
+        }
+    }
+    return strdup(coin_pair);
+}
+
+// Balances arrive as strings or bare numbers; both views hold the digits.
+dec64 json_value_to_dec(const struct json_view *value) {
+    return jv_dec(value);
+}
+
+// Finds the "orders" member of an openOrders response, or reports the error
+// on stderr and returns 0.
+int load_orders(const char *json_response, size_t len, struct json_view *orders) {
+    char err[192];
+    if (!tapi_find_orders(json_response, len, orders, err, sizeof(err))) {
+        fprintf(stderr, "%s\n", err);
+        return 0;
+    }
+    return 1;
+}
+
+struct order_walk {
+    order_row_fn fn;
+    void *ctx;
+};
+
+// Terminates the row's views in stack buffers for the consumers that want C strings.
+static void order_view_row(const struct tapi_order *o, void *ctx) {
+    struct order_walk *walk = ctx;
+    char coin[32], pair[32], price[32], remain[40], remain_idr[40], client_order_id[128], type[8];
+    struct order_row row;
+    row.coin = jv_copy(o->coin, coin, sizeof(coin));
+    row.pair = jv_copy(o->pair, pair, sizeof(pair));
+    row.price = jv_copy(o->price, price, sizeof(price));
+    row.remain = jv_copy(o->remain, remain, sizeof(remain));
+    row.remain_idr = jv_copy(o->remain_idr, remain_idr, sizeof(remain_idr));
+    row.client_order_id = jv_copy(o->client_order_id, client_order_id, sizeof(client_order_id));
+    row.type = jv_copy(o->type, type, sizeof(type));
+    walk->fn(&row, walk->ctx);
+}
+
+// Calls fn for every order. When a single pair was requested "orders" is a
+// bare array and coin_pair names it.
+void walk_orders(const struct json_view *orders, const char *coin_pair, order_row_fn fn, void *ctx) {
+    char pair[64];
+    if (coin_pair) {
+        size_t n = strlen(coin_pair);
+        int has_suffix = n > 4 && strcmp(coin_pair + n - 4, "_idr") == 0;
+        snprintf(pair, sizeof(pair), "%s%s", coin_pair, has_suffix ? "" : "_idr");
+    }
+
+    struct order_walk walk = { fn, ctx };
+    if (!tapi_walk_orders(orders, coin_pair ? pair : NULL, order_view_row, &walk)) {
+        fprintf(stderr, "Unknown 'orders' format in JSON response\n");
+    }
+}
+
+// Rows go into out's buffer, as a table row or a JSONL/CSV record
+static const char *const order_fields[] = { "coin", "pair", "type", "price", "remain", "remain_idr", "client_order_id" };
+
+void print_order_row(const struct order_row *row, void *ctx) {
+    struct output *out = ctx;
+    if (out->format != OUTPUT_TABLE) {
+        const char *values[] = { row->coin, row->pair, row->type, row->price, row->remain, row->remain_idr,
+                                 row->client_order_id };
+        out_record(out, order_fields, values, 7);
+        return;
+    }
+    out_printf(&out->buf, "| %-10s | %-15s | %-17s | %-10s\t | %-4s |\n",
+               row->coin, row->price, row->remain, row->client_order_id, row->type);
+}
+
+void print_orders_header(struct output *out) {
+    if (out->format != OUTPUT_TABLE) {
+        out_header(out, order_fields, 7);
+        return;
+    }
+    out_str(&out->buf, "+------------+-----------------+-------------------+-----------------------------+------+\n"
+                       "| Coin Name  | Price           | Open/Remain Order | Client Order ID             | type |\n"
+                       "+------------+-----------------+-------------------+-----------------------------+------+\n");
+}
+
+void print_orders_footer(struct output *out) {
+    if (out->format != OUTPUT_TABLE) return;
+    out_str(&out->buf, "+------------+-----------------+-------------------+-----------------------------+------+\n");
+}
+
+void format_orders_table(struct output *out, const char *json_response, size_t len, const char *coin_pair) {
+    struct json_view orders;
+    if (!load_orders(json_response, len, &orders)) return;
+
+    print_orders_header(out);
+    walk_orders(&orders, coin_pair, print_order_row, out);
+    print_orders_footer(out);
+}
+
+static const char *const balance_fields[] = { "asset", "available", "hold" };
+
+struct balance_print {
+    struct output *out;
+    int row_count;
+};
+
+static void print_balance_row(struct strview asset, const struct json_view *available,
+                              const struct json_view *hold, void *ctx) {
+    struct balance_print *p = ctx;
+    char name[32], avail_str[DEC_STRLEN] = "0", hold_str[DEC_STRLEN] = "0";
+    jv_copy(asset, name, sizeof(name));
+
+    // Assets only in balance_hold are listed with zeros, as before
+    if (!available) {
+        if (json_value_to_dec(hold) <= 0) return;
+    } else {
+        dec64 avail_value = json_value_to_dec(available);
+        dec64 hold_value = hold ? json_value_to_dec(hold) : 0;
+        if (avail_value <= 0 && hold_value <= 0) return;
+        dec_format(avail_value, avail_str, sizeof(avail_str));
+        dec_format(hold_value, hold_str, sizeof(hold_str));
+    }
+
+    if (p->out->format != OUTPUT_TABLE) {
+        const char *values[] = { name, avail_str, hold_str };
+        out_record(p->out, balance_fields, values, 3);
+    } else {
+        out_printf(&p->out->buf, "| %-10s | %-17s | %-17s |\n", name, avail_str, hold_str);
+    }
+    p->row_count++;
+}
+
+void format_getinfo_table(struct output *out, const char *json_response, size_t len) {
+    struct json_view ret;
+    char err[192];
+    if (!tapi_check_response(json_response, len, &ret, err, sizeof(err))) {
+        fprintf(stderr, "%s\n", err);
+        return;
+    }
+
+    struct json_view balance, balance_hold;
+    if (!tapi_find_balances(&ret, &balance, &balance_hold)) {
+        fprintf(stderr, "Missing balance information\n");
+        return;
+    }
+
+    struct balance_print p = { out, 0 };
+    if (out->format != OUTPUT_TABLE) {
+        out_header(out, balance_fields, 3);
+        tapi_walk_balances(&balance, &balance_hold, print_balance_row, &p);
+        return;
+    }
+    out_str(&out->buf, "+------------+-------------------+-------------------+\n"
+                       "| Asset      | Available Balance | On Hold Balance   |\n"
+                       "+------------+-------------------+-------------------+\n");
+    tapi_walk_balances(&balance, &balance_hold, print_balance_row, &p);
+    if (p.row_count == 0) {
+        out_str(&out->buf, "| No balances found with non-zero values |\n");
+    }
+    out_str(&out->buf, "+------------+-------------------+-------------------+\n");
+}
+
+// A getOrderByClientOrderId reply that stood in for a trade or cancel (see
+// tapi_send in main.c) carries the order one level down.
+static void unwrap_order(struct json_view *ret) {
+    struct json_view order;
+    if (jv_object_get(ret, "order", &order) && order.kind == JV_OBJECT) *ret = order;
+}
+
+// Pulls the display fields out of a trade response. Returns 0 and sets
+// row->error when the response is not a successful trade.
+int parse_trade_response(const char *json_response, size_t len, const char *coin, struct trade_row *row) {
+    memset(row, 0, sizeof(*row));
+
+    struct json_view ret;
+    if (!tapi_check_response(json_response, len, &ret, row->error, sizeof(row->error))) return 0;
+    unwrap_order(&ret);
+
+    struct strview remain = { NULL, 0 }, order_id = { NULL, 0 };
+    struct strview client_order_id = { NULL, 0 }, type = { NULL, 0 };
+    size_t coin_len = strlen(coin);
+
+    struct json_iter it;
+    struct strview key;
+    struct json_view value;
+    jv_iter_init(&it, &ret);
+    while (jv_object_next(&it, &key, &value) > 0) {
+        if (value.kind != JV_STRING && value.kind != JV_NUMBER) continue;
+        if (sv_eq(key, "order_id")) order_id = value.text;
+        else if (sv_eq(key, "client_order_id")) client_order_id = value.text;
+        else if (sv_eq(key, "type")) type = value.text;
+        else if (key.len == coin_len + 7 && memcmp(key.ptr, "remain_", 7) == 0 &&
+                 memcmp(key.ptr + 7, coin, coin_len) == 0) remain = value.text;
+    }
+
+    jv_copy(remain, row->remain, sizeof(row->remain));
+    jv_copy(order_id, row->order_id, sizeof(row->order_id));
+    jv_copy(client_order_id, row->client_order_id, sizeof(row->client_order_id));
+    jv_copy(type, row->type, sizeof(row->type));
+    return 1;
+}
+
+void print_trade_table(struct output *out, const struct trade_row *row, const char *coin, const char *price) {
+    if (out->format != OUTPUT_TABLE) {
+        static const char *const fields[] = { "coin", "type", "price", "remain", "order_id", "client_order_id" };
+        const char *values[] = { coin, row->type, price, row->remain, row->order_id, row->client_order_id };
+        out_header(out, fields, 6);
+        out_record(out, fields, values, 6);
+        return;
+    }
+    out_str(&out->buf, "+------------+-----------------+-------------------+-----------------------------+------+\n"
+                       "| Coin Name  | Price           | Remaining Amount  | Client Order ID             | type }\n"
+                       "+------------+-----------------+-------------------+-----------------------------+------+\n");
+    out_printf(&out->buf, "| %-10s | %-15s | %-17s | %-27s | %-4s |\n",
+               coin, price, row->remain, row->client_order_id, row->type);
+    out_str(&out->buf, "+------------+-----------------+-------------------+-----------------------------+------+\n");
+}
+
+void format_trade_response_table(struct output *out, const char *json_response, size_t len,
+                                 const char *coin, const char *price) {
+    struct trade_row row;
+    if (!parse_trade_response(json_response, len, coin, &row)) {
+        fprintf(stderr, "%s\n", row.error);
+        return;
+    }
+    print_trade_table(out, &row, coin, price);
+}
+
+// Same contract as parse_trade_response, for cancelByClientOrderId replies.
+int parse_cancel_response(const char *json_response, size_t len, struct cancel_row *row) {
+    memset(row, 0, sizeof(*row));
+
+    struct json_view ret;
+    if (!tapi_check_response(json_response, len, &ret, row->error, sizeof(row->error))) return 0;
+    unwrap_order(&ret);
+
+    struct strview pair = { NULL, 0 }, client_order_id = { NULL, 0 }, type = { NULL, 0 };
+    struct json_iter it;
+    struct strview key;
+    struct json_view value;
+    jv_iter_init(&it, &ret);
+    while (jv_object_next(&it, &key, &value) > 0) {
+        if (value.kind != JV_STRING) continue;
+        if (sv_eq(key, "pair")) pair = value.text;
+        else if (sv_eq(key, "client_order_id")) client_order_id = value.text;
+        else if (sv_eq(key, "type")) type = value.text;
+    }
+
+    jv_copy(pair, row->coin, sizeof(row->coin));
+    size_t n = strlen(row->coin);
+    if (n > 4 && strcmp(row->coin + n - 4, "_idr") == 0) row->coin[n - 4] = '\0';
+    jv_copy(client_order_id, row->client_order_id, sizeof(row->client_order_id));
+    jv_copy(type, row->type, sizeof(row->type));
+    return 1;
+}
+
+void print_cancel_table(struct output *out, const struct cancel_row *row) {
+    if (out->format != OUTPUT_TABLE) {
+        static const char *const fields[] = { "coin", "status", "client_order_id", "type" };
+        const char *values[] = { row->coin, "cancelled", row->client_order_id, row->type };
+        out_header(out, fields, 4);
+        out_record(out, fields, values, 4);
+        return;
+    }
+    out_str(&out->buf, "+------------+------------+-----------------------------+------+\n"
+                       "| Coin Name  | Status     | Client Order ID             | Type |\n"
+                       "+------------+------------+-----------------------------+------+\n");
+    out_printf(&out->buf, "| %-10s | %-10s | %-27s | %-4s |\n",
+               row->coin, "Cancelled", row->client_order_id, row->type);
+    out_str(&out->buf, "+------------+------------+-----------------------------+------+\n");
+}
+
+void format_cancel_table(struct output *out, const char *json_response, size_t len) {
+    struct cancel_row row;
+    if (!parse_cancel_response(json_response, len, &row)) {
+        fprintf(stderr, "%s\n", row.error);
+        return;
+    }
+    print_cancel_table(out, &row);
+}
@@ -0,0 +1,58 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stddef.h>
+#include "tapi_json.h"
+#include "decimal.h"
+#include "output.h"
+
+// Results of the single-request commands, parsed out of /tapi replies and
+// written into an output buffer as a table or JSONL/CSV records.
+
+struct order_row {
+    const char *coin;
+    const char *pair;
+    const char *price;
+    const char *remain;
+    const char *remain_idr;     // a buy's unspent IDR, NULL when not known
+    const char *client_order_id;
+    const char *type;
+};
+
+typedef void (*order_row_fn)(const struct order_row *row, void *ctx);
+
+struct trade_row {
+    char remain[32];
+    char order_id[32];
+    char client_order_id[128];
+    char type[8];
+    char error[192];
+};
+
+struct cancel_row {
+    char coin[32];
+    char client_order_id[128];
+    char type[8];
+    char error[192];
+};
+
+char *extract_coin_name(const char *coin_pair);
+dec64 json_value_to_dec(const struct json_view *value);
+
+int load_orders(const char *json_response, size_t len, struct json_view *orders);
+void walk_orders(const struct json_view *orders, const char *coin_pair, order_row_fn fn, void *ctx);
+void print_order_row(const struct order_row *row, void *ctx);
+void print_orders_header(struct output *out);
+void print_orders_footer(struct output *out);
+void format_orders_table(struct output *out, const char *json_response, size_t len, const char *coin_pair);
+void format_getinfo_table(struct output *out, const char *json_response, size_t len);
+
+int parse_trade_response(const char *json_response, size_t len, const char *coin, struct trade_row *row);
+void print_trade_table(struct output *out, const struct trade_row *row, const char *coin, const char *price);
+void format_trade_response_table(struct output *out, const char *json_response, size_t len,
+                                 const char *coin, const char *price);
+int parse_cancel_response(const char *json_response, size_t len, struct cancel_row *row);
+void print_cancel_table(struct output *out, const struct cancel_row *row);
+void format_cancel_table(struct output *out, const char *json_response, size_t len);
+
+#endif
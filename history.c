@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "history.h"
+
+static const char *column_names[HCOL_COUNT] = { "id", "pair", "side", "time", "price", "amount", "fee" };
+
+static void history_reset(struct history_store *h) {
+    memset(h, 0, sizeof(*h));
+    h->meta_fd = -1;
+    for (int c = 0; c < HCOL_COUNT; c++) h->col_fd[c] = -1;
+}
+
+// The header spans several pages and a power loss can persist some of them
+// without the rest. When the per-pair counts no longer add up to rows, they
+// and each pair's last_id are recounted from the id and pair columns.
+static int recount_pairs(struct history_store *h) {
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < h->hdr->npairs; i++) sum += h->hdr->pairs[i].rows;
+    if (sum == h->hdr->rows) return 1;
+
+    for (uint32_t i = 0; i < h->hdr->npairs; i++) {
+        h->hdr->pairs[i].rows = 0;
+        h->hdr->pairs[i].last_id = 0;
+    }
+    int64_t ids[1024], pairs[1024];
+    for (uint64_t done = 0; done < h->hdr->rows;) {
+        size_t n = h->hdr->rows - done < 1024 ? (size_t)(h->hdr->rows - done) : 1024;
+        off_t offset = (off_t)(done * sizeof(int64_t));
+        if (pread(h->col_fd[HCOL_ID], ids, n * sizeof(int64_t), offset) != (ssize_t)(n * sizeof(int64_t)) ||
+            pread(h->col_fd[HCOL_PAIR], pairs, n * sizeof(int64_t), offset) != (ssize_t)(n * sizeof(int64_t))) {
+            return 0;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (pairs[i] < 0 || pairs[i] >= (int64_t)h->hdr->npairs) continue;
+            struct history_pair *p = &h->hdr->pairs[pairs[i]];
+            p->rows++;
+            if (ids[i] > p->last_id) p->last_id = ids[i];
+        }
+        done += n;
+    }
+    return msync(h->hdr, sizeof(*h->hdr), MS_SYNC) == 0;
+}
+
+// Opens (creating if needed) the store in dir and locks it. Column files
+// longer than the committed row count are trimmed back to it.
+int history_open(struct history_store *h, const char *dir) {
+    char path[512];
+    history_reset(h);
+
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        perror("Error creating history directory");
+        return 0;
+    }
+
+    snprintf(path, sizeof(path), "%s/trades.meta", dir);
+    h->meta_fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (h->meta_fd < 0) {
+        perror("Error opening history");
+        return 0;
+    }
+    if (flock(h->meta_fd, LOCK_EX) != 0) {
+        perror("lock history");
+        history_close(h);
+        return 0;
+    }
+
+    struct stat st;
+    int fresh = fstat(h->meta_fd, &st) != 0 || (size_t)st.st_size != sizeof(struct history_header);
+    if (fresh && ftruncate(h->meta_fd, sizeof(struct history_header)) != 0) {
+        perror("resize history");
+        history_close(h);
+        return 0;
+    }
+    void *p = mmap(NULL, sizeof(struct history_header), PROT_READ | PROT_WRITE, MAP_SHARED, h->meta_fd, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap history");
+        h->hdr = NULL;
+        history_close(h);
+        return 0;
+    }
+    h->hdr = p;
+
+    // A foreign or older file is started over, columns included
+    if (fresh || h->hdr->magic != HISTORY_MAGIC || h->hdr->version != HISTORY_VERSION ||
+        h->hdr->ncols != HCOL_COUNT || h->hdr->npairs > HISTORY_MAX_PAIRS) {
+        memset(h->hdr, 0, sizeof(*h->hdr));
+        h->hdr->magic = HISTORY_MAGIC;
+        h->hdr->version = HISTORY_VERSION;
+        h->hdr->ncols = HCOL_COUNT;
+    }
+
+    for (int c = 0; c < HCOL_COUNT; c++) {
+        snprintf(path, sizeof(path), "%s/trades.%s.col", dir, column_names[c]);
+        h->col_fd[c] = open(path, O_RDWR | O_CREAT, 0600);
+        if (h->col_fd[c] < 0 || ftruncate(h->col_fd[c], (off_t)(h->hdr->rows * sizeof(int64_t))) != 0) {
+            perror("Error opening history column");
+            history_close(h);
+            return 0;
+        }
+    }
+    if (!recount_pairs(h)) {
+        perror("Error recounting history");
+        history_close(h);
+        return 0;
+    }
+    return 1;
+}
+
+void history_close(struct history_store *h) {
+    for (int c = 0; c < HCOL_COUNT; c++) {
+        if (h->col[c]) munmap((void *)h->col[c], h->mapped_rows * sizeof(int64_t));
+        if (h->col_fd[c] >= 0) close(h->col_fd[c]);
+    }
+    if (h->hdr) {
+        msync(h->hdr, sizeof(*h->hdr), MS_ASYNC);
+        munmap(h->hdr, sizeof(*h->hdr));
+    }
+    if (h->meta_fd >= 0) close(h->meta_fd);     // also drops the flock
+    history_reset(h);
+}
+
+// Index of pair in the store, added on first use. -1 when the table is full.
+int history_pair(struct history_store *h, const char *pair) {
+    for (uint32_t i = 0; i < h->hdr->npairs; i++) {
+        if (strcmp(h->hdr->pairs[i].name, pair) == 0) return (int)i;
+    }
+    if (h->hdr->npairs >= HISTORY_MAX_PAIRS) return -1;
+
+    struct history_pair *p = &h->hdr->pairs[h->hdr->npairs];
+    memset(p, 0, sizeof(*p));
+    snprintf(p->name, sizeof(p->name), "%s", pair);
+    return (int)h->hdr->npairs++;
+}
+
+static int write_column(int fd, const int64_t *values, size_t n, off_t offset) {
+    const char *data = (const char *)values;
+    size_t len = n * sizeof(int64_t);
+    while (len > 0) {
+        ssize_t w = pwrite(fd, data, len, offset);
+        if (w <= 0) return 0;
+        data += w;
+        len -= w;
+        offset += w;
+    }
+    return 1;
+}
+
+// Appends rows (ascending trade ids) for one pair. Each column is written
+// from a transposed scratch array, then the header commits the new count.
+int history_append(struct history_store *h, int pair, const struct history_row *rows, size_t n) {
+    if (n == 0) return 1;
+
+    int64_t *scratch = malloc(n * sizeof(int64_t));
+    if (!scratch) {
+        fprintf(stderr, "Memory allocation error\n");
+        return 0;
+    }
+
+    off_t offset = (off_t)(h->hdr->rows * sizeof(int64_t));
+    int ok = 1;
+    for (int c = 0; c < HCOL_COUNT && ok; c++) {
+        for (size_t i = 0; i < n; i++) {
+            const struct history_row *r = &rows[i];
+            switch (c) {
+            case HCOL_ID: scratch[i] = r->id; break;
+            case HCOL_PAIR: scratch[i] = pair; break;
+            case HCOL_SIDE: scratch[i] = r->side; break;
+            case HCOL_TIME: scratch[i] = r->time; break;
+            case HCOL_PRICE: scratch[i] = r->price; break;
+            case HCOL_AMOUNT: scratch[i] = r->amount; break;
+            case HCOL_FEE: scratch[i] = r->fee; break;
+            }
+        }
+        ok = write_column(h->col_fd[c], scratch, n, offset);
+    }
+    free(scratch);
+    if (!ok) {
+        perror("write history");
+        return 0;
+    }
+
+    // The columns are on disk before the count that makes them visible, so
+    // after a crash or power loss the count never covers rows that are not
+    for (int c = 0; c < HCOL_COUNT; c++) {
+        if (fdatasync(h->col_fd[c]) != 0) {
+            perror("sync history");
+            return 0;
+        }
+    }
+
+    struct history_pair *p = &h->hdr->pairs[pair];
+    p->rows += n;
+    if (rows[n - 1].id > p->last_id) p->last_id = rows[n - 1].id;
+    h->hdr->rows += n;
+    if (msync(h->hdr, sizeof(*h->hdr), MS_SYNC) != 0) {
+        perror("sync history");
+        return 0;
+    }
+    return 1;
+}
+
+// Maps every column read-only for a scan over the committed rows.
+int history_map(struct history_store *h) {
+    size_t rows = h->hdr->rows;
+    if (rows == 0) return 1;
+    h->mapped_rows = rows;
+    for (int c = 0; c < HCOL_COUNT; c++) {
+        void *p = mmap(NULL, rows * sizeof(int64_t), PROT_READ, MAP_SHARED, h->col_fd[c], 0);
+        if (p == MAP_FAILED) {
+            perror("mmap history column");
+            return 0;
+        }
+        h->col[c] = p;
+        madvise(p, rows * sizeof(int64_t), MADV_SEQUENTIAL);
+    }
+    return 1;
+}
@@ -0,0 +1,68 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "decimal.h"
+
+#define HISTORY_DIR "indodax_history"
+#define HISTORY_MAGIC 0x48584449u      // "IDXH"
+#define HISTORY_VERSION 1
+#define HISTORY_MAX_PAIRS 1024
+
+// Fills are stored column by column, one int64 file per column, so a query
+// only touches the columns it reads. Prices, amounts and fees are dec64.
+enum history_column {
+    HCOL_ID,
+    HCOL_PAIR,          // index into history_header.pairs
+    HCOL_SIDE,          // 0 buy, 1 sell
+    HCOL_TIME,
+    HCOL_PRICE,
+    HCOL_AMOUNT,
+    HCOL_FEE,
+    HCOL_COUNT
+};
+
+struct history_pair {
+    char name[24];
+    int64_t last_id;        // highest trade_id stored, the next sync starts after it
+    uint64_t rows;
+};
+
+// The meta file. rows is bumped only after every column has been written and
+// synced, then the header itself is synced, so even after a power loss
+// anything past rows is a torn append and is cut off on open.
+struct history_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ncols;
+    uint32_t npairs;
+    uint64_t rows;
+    int64_t synced_at;
+    struct history_pair pairs[HISTORY_MAX_PAIRS];
+};
+
+struct history_row {
+    int64_t id;
+    int64_t time;
+    dec64 price;
+    dec64 amount;
+    dec64 fee;
+    int side;
+};
+
+struct history_store {
+    int meta_fd;
+    struct history_header *hdr;
+    int col_fd[HCOL_COUNT];
+    const int64_t *col[HCOL_COUNT];     // set by history_map
+    size_t mapped_rows;
+};
+
+int history_open(struct history_store *h, const char *dir);
+void history_close(struct history_store *h);
+int history_pair(struct history_store *h, const char *pair);
+int history_append(struct history_store *h, int pair, const struct history_row *rows, size_t n);
+int history_map(struct history_store *h);
+
+#endif
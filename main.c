@@ -3,15 +3,53 @@
 #include <string.h>
 #include <time.h>
 #include <curl/curl.h>
-#include <openssl/hmac.h>
-#include <openssl/evp.h>
 #include <ctype.h>
-#include <jansson.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "sign.h"
+#include "response.h"
+#include "sched.h"
+#include "tapi_json.h"
+#include "decimal.h"
+#include "metrics.h"
+#include "book.h"
+#include "order_cache.h"
+#include "nonce.h"
+#include "history.h"
+#include "ticker.h"
+#include "pairs.h"
+#include "watch.h"
+#include "retry.h"
+#include "output.h"
+#include "format.h"
+#include "conn_cache.h"
 
 #define MAX_PAYLOAD 512
 #define MAX_HEADER 256
 #define CONFIG_PATH "indodax_config.txt"
+#define CACHE_PATH "indodax_orders.cache"
+#define CACHE_TTL 60
+#define TICKER_CACHE_PATH "indodax_tickers.cache"
+#define TICKER_TTL 10
+#define PAIRS_CACHE_PATH "indodax_pairs.cache"
+#define PAIRS_TTL 86400
+#define WATCH_MIN_MS 500
+#define WATCH_MAX_MS 10000
 #define MAX_LINE 128
+#define BASE_URL "https://indodax.com"
+#define SOCKET_PATH "/tmp/indodax_api.sock"
+#define MAX_ARGS 16
+#define MAX_REQUEST 1024
+#define BATCH_INFLIGHT 8
+#define BOOK_LEVELS 10
+#define HISTORY_PAGE 1000
+#define MAX_ACCOUNTS 32
+#define DEFAULT_ACCOUNT "default"
 
 void p_head() {
     printf(" _   ___   _      __    ___   _  \n");
@@ -20,20 +58,67 @@ void p_head() {
     printf("indodax api v.001\n\n");
 }
 
-struct MemoryStruct {
-    char *memory;
-    size_t size;
+struct account {
+    char name[32];
+    char *key;
+    char *secret;
 };
 
-void hmac_sha512(const char *data, const char *key, char *out_hex) {
-    unsigned char *digest;
-    digest = HMAC(EVP_sha512(), key, strlen(key), (unsigned char*)data, strlen(data), NULL, NULL);
-    for (int i = 0; i < 64; i++) {
-        sprintf(&out_hex[i*2], "%02x", (unsigned int)digest[i]);
+struct config {
+    char *key;              // the default account's, used unless --accounts is given
+    char *secret;
+    // "default" (the top-level key/secret) first when present, then [name] sections
+    struct account accounts[MAX_ACCOUNTS];
+    int naccounts;
+    char base_url[MAX_LINE];
+    int cache_ttl;          // seconds an openOrders sync stays fresh, 0 disables the cache
+    int ticker_ttl;         // seconds a ticker_all snapshot is reused, 0 always refetches
+    int pairs_ttl;          // seconds pair rules (tick, minimums) are reused
+    int watch_min_ms;       // watch polls this often right after a change...
+    int watch_max_ms;       // ...backing off to this when nothing moves
+    int dns_ttl;            // seconds the resolved exchange address is reused across runs
+    int tls_resume;         // keep the TLS session on disk for the next run
+    char ca_file[MAX_LINE];
+    double rate[CLASS_COUNT];   // requests/s per method class, <= 0 for unlimited
+    double burst[CLASS_COUNT];
+    struct call_policy policy;  // timeouts, retries and hedging
+};
+
+// Per-class defaults, kept under the exchange's published private API limits
+static const double default_rate[CLASS_COUNT] = { 30, 20, 5 };
+// A trade gets one more try (after a lookup), cancels and reads two; reads
+// may be large, so they get longer
+static const long default_timeout_ms[CLASS_COUNT] = { 5000, 5000, 10000 };
+static const int default_retries[CLASS_COUNT] = { 2, 1, 2 };
+
+// Parses rate_<class>=, burst_<class>=, timeout_<class>= (ms) and
+// retries_<class>= lines, ignoring anything else.
+static int read_rate_line(const char *line, struct config *cfg) {
+    static const char *prefixes[] = { "rate_", "burst_", "timeout_", "retries_" };
+    int kind = -1;
+    for (int k = 0; k < 4 && kind < 0; k++) {
+        if (strncmp(line, prefixes[k], strlen(prefixes[k])) == 0) kind = k;
+    }
+    if (kind < 0) return 0;
+    const char *name = line + strlen(prefixes[kind]);
+
+    for (int c = 0; c < CLASS_COUNT; c++) {
+        size_t len = strlen(method_class_name(c));
+        if (strncmp(name, method_class_name(c), len) == 0 && name[len] == '=') {
+            double v = strtod(name + len + 1, NULL);
+            if (kind == 0) cfg->rate[c] = v;
+            else if (kind == 1) cfg->burst[c] = v;
+            else if (kind == 2) cfg->policy.timeout_ms[c] = v > 0 ? (long)v : 0;
+            else cfg->policy.retries[c] = v > 0 ? (int)v : 0;
+            return 1;
+        }
     }
+    return 0;
 }
 
-int read_config(const char *path, char **key, char **secret) {
+void free_config(struct config *cfg);
+
+int read_config(const char *path, struct config *cfg) {
     FILE *file = fopen(path, "r");
     if (!file) {
         perror("Error opening config file");
@@ -41,529 +126,2855 @@ int read_config(const char *path, char **key, char **secret) {
     }
 
     char line[MAX_LINE];
-    *key = NULL;
-    *secret = NULL;
+    memset(cfg, 0, sizeof(*cfg));
+    snprintf(cfg->base_url, sizeof(cfg->base_url), "%s", BASE_URL);
+    cfg->cache_ttl = CACHE_TTL;
+    cfg->ticker_ttl = TICKER_TTL;
+    cfg->pairs_ttl = PAIRS_TTL;
+    cfg->watch_min_ms = WATCH_MIN_MS;
+    cfg->watch_max_ms = WATCH_MAX_MS;
+    cfg->dns_ttl = DNS_TTL;
+    cfg->tls_resume = 1;
+    for (int c = 0; c < CLASS_COUNT; c++) {
+        cfg->rate[c] = default_rate[c];
+        cfg->burst[c] = 0;
+        cfg->policy.timeout_ms[c] = default_timeout_ms[c];
+        cfg->policy.retries[c] = default_retries[c];
+    }
+    cfg->policy.connect_ms = CONNECT_TIMEOUT_MS;
+    cfg->policy.hedge_ms = HEDGE_MS;
+
+    // Slot 0 is kept for the top level; sections fill in after it
+    struct account *cur = &cfg->accounts[0];
+    snprintf(cur->name, sizeof(cur->name), "%s", DEFAULT_ACCOUNT);
+    cfg->naccounts = 1;
+    int ok = 1;
 
     while (fgets(line, sizeof(line), file)) {
-        if (strncmp(line, "key=", 4) == 0) {
-            line[strcspn(line, "\n")] = 0;
-            *key = strdup(line + 4);
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '[') {
+            size_t len = strcspn(line + 1, "]");
+            if (line[1 + len] != ']' || len == 0 || len >= sizeof(cur->name)) {
+                fprintf(stderr, "Bad account section: %s\n", line);
+                ok = 0;
+                break;
+            }
+            if (cfg->naccounts == MAX_ACCOUNTS) {
+                fprintf(stderr, "Too many accounts (at most %d)\n", MAX_ACCOUNTS - 1);
+                ok = 0;
+                break;
+            }
+            cur = &cfg->accounts[cfg->naccounts++];
+            snprintf(cur->name, sizeof(cur->name), "%.*s", (int)len, line + 1);
+            for (int i = 0; i < cfg->naccounts - 1; i++) {
+                if (strcmp(cfg->accounts[i].name, cur->name) == 0) {
+                    fprintf(stderr, "Duplicate account [%s]\n", cur->name);
+                    ok = 0;
+                }
+            }
+            if (!ok) break;
+        }
+        else if (strncmp(line, "key=", 4) == 0) {
+            free(cur->key);
+            cur->key = strdup(line + 4);
         }
         else if (strncmp(line, "secret=", 7) == 0) {
-            line[strcspn(line, "\n")] = 0;
-            *secret = strdup(line + 7);
+            free(cur->secret);
+            cur->secret = strdup(line + 7);
+        }
+        else if (strncmp(line, "base_url=", 9) == 0) {
+            snprintf(cfg->base_url, sizeof(cfg->base_url), "%s", line + 9);
+        }
+        else if (strncmp(line, "cache_ttl=", 10) == 0) {
+            cfg->cache_ttl = atoi(line + 10);
+        }
+        else if (strncmp(line, "ticker_ttl=", 11) == 0) {
+            cfg->ticker_ttl = atoi(line + 11);
+        }
+        else if (strncmp(line, "pairs_ttl=", 10) == 0) {
+            cfg->pairs_ttl = atoi(line + 10);
+        }
+        else if (strncmp(line, "watch_min_ms=", 13) == 0) {
+            cfg->watch_min_ms = atoi(line + 13);
+        }
+        else if (strncmp(line, "watch_max_ms=", 13) == 0) {
+            cfg->watch_max_ms = atoi(line + 13);
+        }
+        else if (strncmp(line, "dns_ttl=", 8) == 0) {
+            cfg->dns_ttl = atoi(line + 8);
+        }
+        else if (strncmp(line, "tls_resume=", 11) == 0) {
+            cfg->tls_resume = atoi(line + 11);
+        }
+        else if (strncmp(line, "connect_timeout_ms=", 19) == 0) {
+            cfg->policy.connect_ms = atol(line + 19);
+        }
+        else if (strncmp(line, "hedge_reads=", 12) == 0) {
+            cfg->policy.hedge = atoi(line + 12);
+        }
+        else if (strncmp(line, "hedge_ms=", 9) == 0) {
+            cfg->policy.hedge_ms = atol(line + 9);
+        }
+        else if (strncmp(line, "ca_file=", 8) == 0) {
+            snprintf(cfg->ca_file, sizeof(cfg->ca_file), "%s", line + 8);
+        }
+        else {
+            read_rate_line(line, cfg);
         }
     }
     fclose(file);
 
-    if (!*key || !*secret) {
+    // Unless set, a class may burst one second's worth of requests
+    for (int c = 0; c < CLASS_COUNT; c++) {
+        if (cfg->burst[c] <= 0) cfg->burst[c] = cfg->rate[c] > 1 ? cfg->rate[c] : 1;
+    }
+
+    // The environment wins so a test harness can redirect an existing config
+    const char *env_url = getenv("INDODAX_BASE_URL");
+    if (env_url && *env_url) {
+        snprintf(cfg->base_url, sizeof(cfg->base_url), "%s", env_url);
+    }
+
+    for (int i = 1; ok && i < cfg->naccounts; i++) {
+        if (!cfg->accounts[i].key || !cfg->accounts[i].secret) {
+            fprintf(stderr, "Account [%s] missing key or secret\n", cfg->accounts[i].name);
+            ok = 0;
+        }
+    }
+
+    // Without a top-level pair the first section is the default account
+    struct account *top = &cfg->accounts[0];
+    if (ok && !top->key && !top->secret && cfg->naccounts > 1) {
+        memmove(top, top + 1, (cfg->naccounts - 1) * sizeof(*top));
+        cfg->naccounts--;
+    }
+    if (ok && (!top->key || !top->secret)) {
         fprintf(stderr, "Config file missing key or secret\n");
-        free(*key);
-        free(*secret);
+        ok = 0;
+    }
+    if (!ok) {
+        free_config(cfg);
         return 0;
     }
+
+    cfg->key = strdup(top->key);
+    cfg->secret = strdup(top->secret);
     return 1;
 }
 
-static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    struct MemoryStruct *mem = (struct MemoryStruct *)userp;
-    
-    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
-    if(!ptr) {
-        fprintf(stderr, "Memory allocation error\n");
-        return 0;
+void free_config(struct config *cfg) {
+    for (int i = 0; i < cfg->naccounts; i++) {
+        free(cfg->accounts[i].key);
+        free(cfg->accounts[i].secret);
     }
-    
-    mem->memory = ptr;
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->memory[mem->size] = 0;
-    
-    return realsize;
+    cfg->naccounts = 0;
+    free(cfg->key);
+    free(cfg->secret);
+    cfg->key = NULL;
+    cfg->secret = NULL;
 }
 
-char* extract_coin_name(const char *coin_pair) {
-    if (!coin_pair) return strdup("N/A");
-    
-    const char *underscore = strchr(coin_pair, '_');
-    if (underscore && (strcmp(underscore, "_idr") == 0)) {
-        size_t len = underscore - coin_pair;
-        char *coin_name = malloc(len + 1);
-        if (coin_name) {
-            strncpy(coin_name, coin_pair, len);
-            coin_name[len] = '\0';
-            return coin_name;
-        }
+enum response_kind {
+    RESP_RAW,
+    RESP_ORDERS,
+    RESP_GETINFO,
+    RESP_TRADE,
+    RESP_CANCEL
+};
+
+struct tapi_request {
+    char postdata[MAX_PAYLOAD];
+    char client_order_id[128];
+    enum response_kind kind;
+    const char *coin_pair_arg;
+    const char *trade_coin;
+    const char *trade_price;
+};
+
+// One account picked with --accounts. Each has its own signer and rate
+// limits, since the exchange meters every API key separately.
+struct account_client {
+    const char *name;
+    const char *key;
+    struct hmac_signer signer;
+    struct rate_limiter limiter;
+};
+
+// Per-process connection state. One-shot commands use it once; serve keeps it
+// alive so the handle's connection, TLS session and response buffer are reused.
+struct tapi_client {
+    CURL *curl;
+    const char *key;
+    const struct hmac_signer *signer;
+    char base_url[MAX_LINE];
+    char tapi_url[MAX_LINE + 8];
+    struct MemoryStruct response;
+    int timings;                        // print per-request phase timings to stderr
+    enum metrics_format metrics_format;
+    struct metrics *metrics;            // aggregated histograms, NULL when not collecting
+    int cache_ttl;
+    int ticker_ttl;
+    int pairs_ttl;
+    struct pair_table pairs;            // empty until an order needs checking
+    int watch_min_ms;
+    int watch_max_ms;
+    struct output out;                  // --output format and the buffer results are built in
+    int verify;                         // reconcile the order cache against the exchange
+    struct rate_limiter limiter;        // shared by every /tapi call this process makes
+    CURLM *multi;                       // created on first concurrent use, kept for serve
+    struct account_client *accounts;    // --accounts selection, NULL for the default account only
+    int naccounts;
+    CURL *hedge[2];                     // hedged reads race on these, created on first use
+    struct MemoryStruct hedge_response[2];
+};
+
+void record_timings(struct tapi_client *client, const char *postdata, const struct request_timings *t, int ok) {
+    if (client->timings) {
+        timings_print_json(stderr, postdata, t);
+    }
+    if (client->metrics) {
+        metrics_record(client->metrics, t, ok);
     }
-    return strdup(coin_pair);
 }
 
-double json_value_to_double(json_t *value) {
-    if (json_is_real(value)) {
-        return json_real_value(value);
-    } else if (json_is_integer(value)) {
-        return (double)json_integer_value(value);
-    } else if (json_is_string(value)) {
-        return atof(json_string_value(value));
-    }
-    return 0.0;
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: \t%s <openallorder> or <open>\n", prog);
+    fprintf(stderr, "\t%s <openorder> <coin>\n", prog);
+    fprintf(stderr, "\t%s <buy> <coin> <coin_price> <spend_idr>\n", prog);
+    fprintf(stderr, "\t%s <sell> <coin> <coin_price> <quantity>\n", prog);
+    fprintf(stderr, "\t%s <cancel> <orderid>\n", prog);
+    fprintf(stderr, "\t%s cancelall [coin]\n", prog);
+    fprintf(stderr, "\t%s portfolio\n", prog);
+    fprintf(stderr, "\t%s sync-history [coin...]\n", prog);
+    fprintf(stderr, "\t%s history [coin]\n", prog);
+    fprintf(stderr, "\t%s getInfo\n", prog);
+    fprintf(stderr, "\t%s batch <file> [max_inflight]\n", prog);
+    fprintf(stderr, "\t%s book <coin> [levels]\n", prog);
+    fprintf(stderr, "\t%s sync-clock\n", prog);
+    fprintf(stderr, "\t%s vwap <coin> <buy|sell> <size>\n", prog);
+    fprintf(stderr, "\t(buy/sell also take best, best+N or best-N ticks as coin_price)\n");
+    fprintf(stderr, "\t%s serve [socket_path]\n", prog);
+    fprintf(stderr, "\t%s remote <command> [args...]\n", prog);
+    fprintf(stderr, "\t%s metrics [json|prom]   (serve only)\n", prog);
+    fprintf(stderr, "\t%s watch <open [coin]|getInfo>\n", prog);
+    fprintf(stderr, "\t%s about\n", prog);
+    fprintf(stderr, "Options:\t--timings[=json|prom]  per-request phase timings on stderr\n");
+    fprintf(stderr, "\t\t--verify  open/openorder: reconcile the local order cache with the exchange\n");
+    fprintf(stderr, "\t\t--accounts a,b|all  getInfo/open/openorder/cancelall across config [sections]\n");
+    fprintf(stderr, "\t\t--output table|jsonl|csv|raw  open/openorder/getInfo/buy/sell/cancel result format\n");
+    fprintf(stderr, "\t\t--jsonl  same as --output jsonl; for watch, one JSON event per line\n");
 }
 
-void format_orders_table(const char *json_response, const char *coin_pair) {
-    json_error_t error;
-    json_t *root = json_loads(json_response, 0, &error);
-    if (!root) {
-        fprintf(stderr, "JSON error: %s\n", error.text);
-        return;
+// Every command with the argc it needs at least (program and command name
+// included), so a typo fails before the config or the network is touched.
+static int command_valid(int argc, char *argv[]) {
+    static const struct { const char *name; int min_argc; } commands[] = {
+        { "open", 2 }, { "openallorder", 2 }, { "openorder", 3 }, { "buy", 5 }, { "sell", 5 },
+        { "cancel", 3 }, { "cancelall", 2 }, { "portfolio", 2 }, { "sync-history", 2 },
+        { "history", 2 }, { "getInfo", 2 }, { "getinfo", 2 }, { "batch", 3 }, { "book", 3 },
+        { "sync-clock", 2 }, { "vwap", 5 }, { "serve", 2 }, { "remote", 3 }, { "metrics", 2 },
+        { "watch", 3 }, { "about", 2 },
+    };
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        if (strcmp(argv[1], commands[i].name) == 0) return argc >= commands[i].min_argc;
     }
-    
-    json_t *success = json_object_get(root, "success");
-    if (!json_is_integer(success)) {
-        fprintf(stderr, "Invalid success field\n");
-        json_decref(root);
-        return;
+    return 0;
+}
+
+void build_trade_postdata(char *buf, size_t size, const char *side, const char *coin, const char *price,
+                          const char *amount, const char *client_order_id, long epoch_ms, long recv_window) {
+    if (strcmp(side, "sell") == 0) {
+        snprintf(buf, size,
+                 "method=trade&timestamp=%ld&recvWindow=%ld&pair=%s_idr&type=sell&price=%s&idr=%s&client_order_id=%s&%s=%s",
+                 epoch_ms, recv_window, coin, price, amount, client_order_id, coin, amount);
+    } else {
+        snprintf(buf, size,
+                 "method=trade&timestamp=%ld&recvWindow=%ld&pair=%s_idr&type=buy&price=%s&idr=%s&client_order_id=%s",
+                 epoch_ms, recv_window, coin, price, amount, client_order_id);
     }
-    
-    if (json_integer_value(success)) {
-        json_t *return_obj = json_object_get(root, "return");
-        if (!return_obj) {
-            fprintf(stderr, "Missing 'return' object\n");
-            json_decref(root);
-            return;
-        }
-        
-        json_t *orders = json_object_get(return_obj, "orders");
-        if (!orders) {
-            fprintf(stderr, "Missing 'orders' object\n");
-            json_decref(root);
-            return;
-        }
-        
-        printf("+------------+-----------------+-------------------+-----------------------------+------+\n");
-        printf("| Coin Name  | Price           | Open/Remain Order | Client Order ID             | type |\n");
-        printf("+------------+-----------------+-------------------+-----------------------------+------+\n");
-        
-        if (json_is_object(orders)) {
-            const char *coin_pair_key;
-            json_t *order_array;
-            json_object_foreach(orders, coin_pair_key, order_array) {
-                if (!json_is_array(order_array)) continue;
-                
-                char *coin_name = extract_coin_name(coin_pair_key);
-                
-                size_t index;
-                json_t *order;
-                json_array_foreach(order_array, index, order) {
-                    json_t *price = json_object_get(order, "price");
-                    json_t *orderid = json_object_get(order, "client_order_id");
-		    json_t *type = json_object_get(order, "type");
-                    
-                    char remain_field[64];
-                    snprintf(remain_field, sizeof(remain_field), "remain_%s", coin_name);
-                    json_t *remain = json_object_get(order, remain_field);
-                    
-                    const char *price_str = json_is_string(price) ? json_string_value(price) : "N/A";
-                    const char *remain_str = json_is_string(remain) ? json_string_value(remain) : "N/A";
-                    const char *orderid_str = json_is_string(orderid) ? json_string_value(orderid) : "N/A";
-		    const char *type_str = json_is_string(type) ? json_string_value(type) : "N/A";
-                    
-                    printf("| %-10s | %-15s | %-17s | %-10s\t | %-4s |\n", coin_name, price_str, remain_str, orderid_str, type_str);
-                }
-                free(coin_name);
-            }
-        } else if (json_is_array(orders)) {
-            char *coin_name = coin_pair ? extract_coin_name(coin_pair) : strdup("N/A");
-            
-            size_t index;
-            json_t *order;
-            json_array_foreach(orders, index, order) {
-                json_t *price = json_object_get(order, "price");
-                json_t *orderid = json_object_get(order, "client_order_id");
-		json_t *type = json_object_get(order, "type");
-
-                char remain_field[64];
-                snprintf(remain_field, sizeof(remain_field), "remain_%s", coin_name);
-                json_t *remain = json_object_get(order, remain_field);
-                
-                const char *price_str = json_is_string(price) ? json_string_value(price) : "N/A";
-                const char *remain_str = json_is_string(remain) ? json_string_value(remain) : "N/A";
-                const char *orderid_str = json_is_string(orderid) ? json_string_value(orderid) : "N/A";
-		const char *type_str = json_is_string(type) ? json_string_value(type) : "N/A";
-
-                printf("| %-10s | %-15s | %-17s | %-10s\t | %-4s |\n", coin_name, price_str, remain_str, orderid_str, type_str);
-            }
-            free(coin_name);
-        } else {
-            fprintf(stderr, "Unknown 'orders' format in JSON response\n");
-        }
-        
-        printf("+------------+-----------------+-------------------+-----------------------------+------+\n");
+}
+
+void build_cancel_postdata(char *buf, size_t size, const char *client_order_id, long epoch_ms, long recv_window) {
+    snprintf(buf, size, "method=cancelByClientOrderId&timestamp=%ld&recvWindow=%ld&client_order_id=%s",
+             epoch_ms, recv_window, client_order_id);
+}
+
+// Fills req from the command line. Returns 0 when the arguments don't form a valid command.
+int build_request(int argc, char *argv[], struct tapi_request *req) {
+    long epoch_ms = (long)nonce_ms();
+    long recv_window = epoch_ms + 49900000;
+    const char *command = argv[1];
+
+    memset(req, 0, sizeof(*req));
+    req->kind = RESP_RAW;
+
+    if ((strcmp(command, "openallorder") == 0) || (strcmp(command, "open") == 0)) {
+        req->kind = RESP_ORDERS;
+        snprintf(req->postdata, sizeof(req->postdata),
+                 "method=openOrders&timestamp=%ld&recvWindow=%ld",
+                 epoch_ms, recv_window);
+    } else if (strcmp(command, "openorder") == 0 && argc >= 3) {
+        req->kind = RESP_ORDERS;
+        req->coin_pair_arg = argv[2];
+        snprintf(req->postdata, sizeof(req->postdata),
+                 "method=openOrders&timestamp=%ld&recvWindow=%ld&pair=%s_idr",
+                 epoch_ms, recv_window, req->coin_pair_arg);
+    } else if (strcmp(command, "buy") == 0 && argc >= 5) {
+        req->kind = RESP_TRADE;
+        req->trade_coin = argv[2];
+        req->trade_price = argv[3];
+        order_id_next(req->client_order_id, sizeof(req->client_order_id), argv[2]);
+        build_trade_postdata(req->postdata, sizeof(req->postdata), "buy", argv[2], argv[3], argv[4],
+                             req->client_order_id, epoch_ms, recv_window);
+    } else if (strcmp(command, "sell") == 0 && argc >= 5) {
+        req->kind = RESP_TRADE;
+        req->trade_coin = argv[2];
+        req->trade_price = argv[3];
+        order_id_next(req->client_order_id, sizeof(req->client_order_id), argv[2]);
+        build_trade_postdata(req->postdata, sizeof(req->postdata), "sell", argv[2], argv[3], argv[4],
+                             req->client_order_id, epoch_ms, recv_window);
+    } else if (strcmp(command, "cancel") == 0 && argc >= 3) {
+        req->kind = RESP_CANCEL;
+        build_cancel_postdata(req->postdata, sizeof(req->postdata), argv[2], epoch_ms, recv_window);
+    } else if ( (strcmp(command, "getinfo") == 0) || (strcmp(command, "getInfo") == 0) ) {
+        req->kind = RESP_GETINFO;
+        snprintf(req->postdata, sizeof(req->postdata),
+                 "method=getInfo&timestamp=%ld&recvWindow=%ld",
+                 epoch_ms, recv_window);
     } else {
-        json_t *error_field = json_object_get(root, "error");
-        if (json_is_string(error_field)) {
-            fprintf(stderr, "API Error: %s\n", json_string_value(error_field));
-        } else {
-            fprintf(stderr, "Unknown API error\n");
-        }
+        return 0;
     }
-    
-    json_decref(root);
+    return 1;
 }
 
-void format_getinfo_table(const char *json_response) {
-    json_error_t error;
-    json_t *root = json_loads(json_response, 0, &error);
-    if (!root) {
-        fprintf(stderr, "JSON error: %s\n", error.text);
-        return;
+// A trade that is still (partly) open goes into the cache; one that filled on
+// the spot never shows up in openOrders, so it is left out.
+void cache_apply_trade(struct order_cache *cache, const struct trade_row *row, const char *coin, const char *price) {
+    if (strcmp(row->remain, "N/A") != 0 && dec_from_str(row->remain) == 0) return;
+
+    char pair[64];
+    snprintf(pair, sizeof(pair), "%s_idr", coin);
+    order_cache_put(cache, row->client_order_id, pair, row->type, price, row->remain);
+}
+
+struct cache_sync {
+    struct order_cache *cache;
+    const char *pair;       // scope of the sync, NULL for every pair
+    char **ids;             // client_order_ids seen on the exchange (verify only)
+    size_t nids, cap;
+    int differences;
+    FILE *report;           // stdout, or stderr when stdout carries JSONL/CSV
+};
+
+static void verify_order_row(const struct order_row *row, void *ctx) {
+    struct cache_sync *sync = ctx;
+    const struct cached_order *cached = order_cache_get(sync->cache, row->client_order_id);
+
+    if (!cached) {
+        fprintf(sync->report, "+ %-27s %-10s %-4s %s not in local cache\n", row->client_order_id, row->coin, row->type, row->price);
+        sync->differences++;
+    } else if (strcmp(cached->price, row->price) != 0 || strcmp(cached->remain, row->remain) != 0) {
+        fprintf(sync->report, "~ %-27s %-10s remain %s -> %s\n", row->client_order_id, row->coin, cached->remain, row->remain);
+        sync->differences++;
     }
-    
-    json_t *success = json_object_get(root, "success");
-    if (!json_is_integer(success)) {
-        fprintf(stderr, "Invalid success field\n");
-        json_decref(root);
-        return;
+
+    if (sync->nids == sync->cap) {
+        sync->cap = sync->cap ? sync->cap * 2 : 64;
+        char **tmp = realloc(sync->ids, sync->cap * sizeof(*tmp));
+        if (!tmp) return;
+        sync->ids = tmp;
     }
-    
-    if (json_integer_value(success)) {
-        json_t *return_obj = json_object_get(root, "return");
-        if (!return_obj) {
-            fprintf(stderr, "Missing 'return' object\n");
-            json_decref(root);
-            return;
-        }
-        
-        json_t *balance = json_object_get(return_obj, "balance");
-        json_t *balance_hold = json_object_get(return_obj, "balance_hold");
-        
-        if (!balance || !balance_hold) {
-            fprintf(stderr, "Missing balance information\n");
-            json_decref(root);
-            return;
-        }
-        
-        printf("+------------+-------------------+-------------------+\n");
-        printf("| Asset      | Available Balance | On Hold Balance   |\n");
-        printf("+------------+-------------------+-------------------+\n");
-        
-        const char *asset;
-        json_t *value;
-        int row_count = 0;
-        
-        json_object_foreach(balance, asset, value) {
-            double available = json_value_to_double(value);
-            double hold = 0.0;
-            
-            json_t *hold_value = json_object_get(balance_hold, asset);
-            if (hold_value) {
-                hold = json_value_to_double(hold_value);
-            }
-            
-            if (available > 0 || hold > 0) {
-                char avail_str[32], hold_str[32];
-                snprintf(avail_str, sizeof(avail_str), "%.8f", available);
-                snprintf(hold_str, sizeof(hold_str), "%.8f", hold);
-                
-                char *ptr;
-                for (ptr = avail_str + strlen(avail_str) - 1; ptr > avail_str && *ptr == '0'; ptr--) *ptr = '\0';
-                if (*ptr == '.') *ptr = '\0';
-                for (ptr = hold_str + strlen(hold_str) - 1; ptr > hold_str && *ptr == '0'; ptr--) *ptr = '\0';
-                if (*ptr == '.') *ptr = '\0';
-                
-                printf("| %-10s | %-17s | %-17s |\n", asset, avail_str, hold_str);
-                row_count++;
-            }
-        }
-        
-        json_object_foreach(balance_hold, asset, value) {
-            if (!json_object_get(balance, asset)) {
-                double hold = json_value_to_double(value);
-                if (hold > 0) {
-                    printf("| %-10s | %-17s | %-17s |\n", asset, "0", "0");
-                    row_count++;
-                }
+    sync->ids[sync->nids++] = strdup(row->client_order_id);
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void store_order_row(const struct order_row *row, void *ctx) {
+    struct cache_sync *sync = ctx;
+    order_cache_put(sync->cache, row->client_order_id, row->pair, row->type, row->price, row->remain);
+}
+
+// Replaces the cached orders in scope with what the exchange just returned.
+// With verify, first reports every difference between the two.
+void sync_order_cache(struct tapi_client *client, const struct json_view *orders, const char *coin_pair) {
+    if (client->cache_ttl <= 0 && !client->verify) return;
+
+    struct order_cache cache;
+    if (!order_cache_open(&cache, CACHE_PATH)) return;
+
+    char pair[64];
+    struct cache_sync sync;
+    memset(&sync, 0, sizeof(sync));
+    sync.cache = &cache;
+    sync.report = client->out.format == OUTPUT_TABLE ? stdout : stderr;
+    if (coin_pair) {
+        snprintf(pair, sizeof(pair), "%s_idr", coin_pair);
+        sync.pair = pair;
+    }
+
+    if (client->verify) {
+        walk_orders(orders, coin_pair, verify_order_row, &sync);
+        qsort(sync.ids, sync.nids, sizeof(*sync.ids), cmp_str);
+
+        for (uint32_t i = 0; i < cache.hdr->capacity; i++) {
+            const struct cached_order *c = &cache.slots[i];
+            if (c->state != SLOT_USED || (sync.pair && strcmp(c->pair, sync.pair) != 0)) continue;
+            const char *id = c->client_order_id;
+            if (!bsearch(&id, sync.ids, sync.nids, sizeof(*sync.ids), cmp_str)) {
+                fprintf(sync.report, "- %-27s %-10s %-4s %s no longer open on the exchange\n", c->client_order_id, c->pair, c->type, c->price);
+                sync.differences++;
             }
         }
-        
-        if (row_count == 0) {
-            printf("| No balances found with non-zero values |\n");
-        }
-        
-        printf("+------------+-------------------+-------------------+\n");
-    } else {
-        json_t *error_field = json_object_get(root, "error");
-        if (json_is_string(error_field)) {
-            fprintf(stderr, "API Error: %s\n", json_string_value(error_field));
-        } else {
-            fprintf(stderr, "Unknown API error\n");
-        }
+        fprintf(sync.report, "Cache verify: %d difference%s\n", sync.differences, sync.differences == 1 ? "" : "s");
+
+        for (size_t i = 0; i < sync.nids; i++) free(sync.ids[i]);
+        free(sync.ids);
     }
-    
-    json_decref(root);
+
+    order_cache_clear(&cache, sync.pair);
+    walk_orders(orders, coin_pair, store_order_row, &sync);
+    if (!sync.pair) cache.hdr->synced_at = time(NULL);
+    order_cache_close(&cache);
 }
 
-void format_trade_response_table(const char *json_response, const char *coin, const char *price) {
-    json_error_t error;
-    json_t *root = json_loads(json_response, 0, &error);
-    if (!root) {
-        fprintf(stderr, "JSON error: %s\n", error.text);
-        return;
-    }
-    
-    json_t *success = json_object_get(root, "success");
-    if (!json_is_integer(success)) {
-        fprintf(stderr, "Invalid success field\n");
-        json_decref(root);
-        return;
+// Answers open/openorder from the cache when the last full sync is recent
+// enough. Returns 0 when the caller has to ask the exchange instead.
+int print_cached_orders(struct tapi_client *client, const char *coin_pair) {
+    if (client->cache_ttl <= 0 || client->verify || client->out.format == OUTPUT_RAW) return 0;
+
+    struct order_cache cache;
+    if (!order_cache_open(&cache, CACHE_PATH)) return 0;
+    if (!order_cache_fresh(&cache, client->cache_ttl)) {
+        order_cache_close(&cache);
+        return 0;
     }
-    
-    if (json_integer_value(success)) {
-        json_t *return_obj = json_object_get(root, "return");
-        if (!return_obj) {
-            fprintf(stderr, "Missing 'return' object\n");
-            json_decref(root);
-            return;
-        }
-        
-        // Build dynamic field names
-        char remain_field[64];
-        snprintf(remain_field, sizeof(remain_field), "remain_%s", coin);
-        
-        json_t *remain_value = json_object_get(return_obj, remain_field);
-        json_t *order_id = json_object_get(return_obj, "order_id");
-        json_t *client_order_id = json_object_get(return_obj, "client_order_id");
-        json_t *type = json_object_get(return_obj, "type");
-        
-        const char *remain_str = json_is_string(remain_value) ? json_string_value(remain_value) : "N/A";
-        const char *order_id_str = json_is_integer(order_id) ? "N/A" : json_string_value(order_id);
-        const char *client_order_id_str = json_is_string(client_order_id) ? json_string_value(client_order_id) : "N/A";
-        const char *type_str = json_is_string(type) ? json_string_value(type) : "N/A";
-        
-        // Handle integer order_id
-        char order_id_buffer[32];
-        if (json_is_integer(order_id)) {
-            snprintf(order_id_buffer, sizeof(order_id_buffer), "%lld", json_integer_value(order_id));
-            order_id_str = order_id_buffer;
-        }
-        
-        printf("+------------+-----------------+-------------------+-----------------------------+------+\n");
-        printf("| Coin Name  | Price           | Remaining Amount  | Client Order ID             | type }\n");
-        printf("+------------+-----------------+-------------------+-----------------------------+------+\n");
-        printf("| %-10s | %-15s | %-17s | %-27s | %-4s |\n", coin, price, remain_str, client_order_id_str, type_str);
-        printf("+------------+-----------------+-------------------+-----------------------------+------+\n");
-    } else {
-        json_t *error_field = json_object_get(root, "error");
-        if (json_is_string(error_field)) {
-            fprintf(stderr, "API Error: %s\n", json_string_value(error_field));
-        } else {
-            fprintf(stderr, "Unknown API error\n");
-        }
+
+    char pair[64];
+    if (coin_pair) snprintf(pair, sizeof(pair), "%s_idr", coin_pair);
+
+    print_orders_header(&client->out);
+    for (uint32_t i = 0; i < cache.hdr->capacity; i++) {
+        const struct cached_order *c = &cache.slots[i];
+        if (c->state != SLOT_USED || (coin_pair && strcmp(c->pair, pair) != 0)) continue;
+
+        char *coin_name = extract_coin_name(c->pair);
+        struct order_row row = { coin_name, c->pair, c->price, c->remain, NULL, c->client_order_id, c->type };
+        print_order_row(&row, &client->out);
+        free(coin_name);
     }
-    
-    json_decref(root);
+    print_orders_footer(&client->out);
+    out_flush(&client->out);
+    fprintf(stderr, "(local cache, synced %lds ago; --verify to reconcile)\n", (long)(time(NULL) - cache.hdr->synced_at));
+
+    order_cache_close(&cache);
+    return 1;
 }
 
-void format_cancel_table(const char *json_response) {
-    json_error_t error;
-    json_t *root = json_loads(json_response, 0, &error);
-    if (!root) {
-        fprintf(stderr, "JSON error: %s\n", error.text);
-        return;
-    }
-    
-    json_t *success = json_object_get(root, "success");
-    if (!json_is_integer(success)) {
-        fprintf(stderr, "Invalid success field\n");
-        json_decref(root);
+// The result is written before the cache sync, whose --verify report follows it.
+void show_orders(struct tapi_client *client, const char *json_response, size_t len, const char *coin_pair) {
+    struct json_view orders;
+    if (!load_orders(json_response, len, &orders)) return;
+
+    print_orders_header(&client->out);
+    walk_orders(&orders, coin_pair, print_order_row, &client->out);
+    print_orders_footer(&client->out);
+    out_flush(&client->out);
+    sync_order_cache(client, &orders, coin_pair);
+}
+
+void show_trade(struct tapi_client *client, const char *json_response, size_t len, const char *coin, const char *price) {
+    struct trade_row row;
+    if (!parse_trade_response(json_response, len, coin, &row)) {
+        fprintf(stderr, "%s\n", row.error);
         return;
     }
-    
-    if (json_integer_value(success)) {
-        json_t *return_obj = json_object_get(root, "return");
-        if (!return_obj) {
-            fprintf(stderr, "Missing 'return' object\n");
-            json_decref(root);
-            return;
-        }
-        
-        json_t *pair = json_object_get(return_obj, "pair");
-        json_t *client_order_id = json_object_get(return_obj, "client_order_id");
-        json_t *type = json_object_get(return_obj, "type");
-        
-        const char *pair_str = json_is_string(pair) ? json_string_value(pair) : "N/A";
-        const char *client_order_id_str = json_is_string(client_order_id) ? json_string_value(client_order_id) : "N/A";
-        const char *type_str = json_is_string(type) ? json_string_value(type) : "N/A";
-        
-        char *coin_name = extract_coin_name(pair_str);
-        
-        printf("+------------+------------+-----------------------------+------+\n");
-        printf("| Coin Name  | Status     | Client Order ID             | Type |\n");
-        printf("+------------+------------+-----------------------------+------+\n");
-        printf("| %-10s | %-10s | %-27s | %-4s |\n", 
-               coin_name, "Cancelled", client_order_id_str, type_str);
-        printf("+------------+------------+-----------------------------+------+\n");
-        
-        free(coin_name);
-    } else {
-        json_t *error_field = json_object_get(root, "error");
-        if (json_is_string(error_field)) {
-            fprintf(stderr, "API Error: %s\n", json_string_value(error_field));
-        } else {
-            fprintf(stderr, "Unknown API error\n");
-        }
+    if (client->out.format != OUTPUT_RAW) print_trade_table(&client->out, &row, coin, price);
+
+    struct order_cache cache;
+    if (client->cache_ttl > 0 && order_cache_open(&cache, CACHE_PATH)) {
+        cache_apply_trade(&cache, &row, coin, price);
+        order_cache_close(&cache);
     }
-    
-    json_decref(root);
 }
 
-int main(int argc, char *argv[]) {
-    char *key = NULL;
-    char *secret = NULL;
-    
-    if (!read_config(CONFIG_PATH, &key, &secret)) {
-        return 1;
+void show_cancel(struct tapi_client *client, const char *json_response, size_t len) {
+    struct cancel_row row;
+    if (!parse_cancel_response(json_response, len, &row)) {
+        fprintf(stderr, "%s\n", row.error);
+        return;
     }
+    if (client->out.format != OUTPUT_RAW) print_cancel_table(&client->out, &row);
 
-    if (argc < 2) {
-	p_head();
-        fprintf(stderr, "Usage: \t%s <openallorder> or <open>\n", argv[0]);
-        fprintf(stderr, "\t%s <openorder> <coin>\n", argv[0]);
-        fprintf(stderr, "\t%s <buy> <coin> <coin_price> <spend_idr>\n", argv[0]);
-        fprintf(stderr, "\t%s <sell> <coin> <coin_price> <quantity>\n", argv[0]);
-        fprintf(stderr, "\t%s <cancel> <orderid>\n", argv[0]);
-        fprintf(stderr, "\t%s getInfo\n", argv[0]);
-        fprintf(stderr, "\t%s about\n", argv[0]);
-        free(key);
-        free(secret);
-        return 1;
+    struct order_cache cache;
+    if (client->cache_ttl > 0 && order_cache_open(&cache, CACHE_PATH)) {
+        order_cache_remove(&cache, row.client_order_id);
+        order_cache_close(&cache);
     }
+}
 
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "curl init failed\n");
-        free(key);
-        free(secret);
-        return 1;
+CURLM *client_multi(struct tapi_client *client, int max_inflight);
+
+// Races a read on two connections: the second copy goes out once the first
+// has taken longer than the hedge delay (p95 of earlier reads), and whichever
+// answers first wins. Both run on HTTP/1.1 handles of the client's multi, so
+// the copy really takes its own connection.
+static CURLcode hedged_perform(struct tapi_client *client, const char *postdata, struct curl_slist *headers,
+                               struct request_timings *timings) {
+    CURLM *multi = client_multi(client, 2);
+    if (!multi) return CURLE_FAILED_INIT;
+    for (int i = 0; i < 2; i++) {
+        if (!client->hedge[i]) {
+            client->hedge[i] = curl_easy_init();
+            if (!client->hedge[i]) return CURLE_FAILED_INIT;
+            conn_cache_setup(client->hedge[i]);
+            curl_easy_setopt(client->hedge[i], CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_1_1);
+            curl_easy_setopt(client->hedge[i], CURLOPT_TCP_KEEPALIVE, 1L);
+        }
+        CURL *easy = client->hedge[i];
+        retry_apply(easy, CLASS_READ);
+        curl_easy_setopt(easy, CURLOPT_URL, client->tapi_url);
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, postdata);
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, headers);
+        response_reset(&client->hedge_response[i], easy);
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, (void *)&client->hedge_response[i]);
     }
 
-    time_t t = time(NULL);
-    long epoch_ms = t * 1000;
-    long recv_window = epoch_ms + 49900000;
+    uint64_t delay = retry_hedge_delay_us();
+    uint64_t deadline = monotonic_us() + delay;
+    int added = 1, failed = 0, winner = -1;
+    CURLcode res = CURLE_OK;
+    curl_multi_add_handle(multi, client->hedge[0]);
 
-    char postdata[MAX_PAYLOAD] = {0};
-    char client_order_id[128] = {0};
-    const char *command = argv[1];
-    int format_table = 0;
-    const char *coin_pair_arg = NULL;
-    int is_getinfo = 0;
-    int is_trade = 0;
-    int is_cancel = 0;
-    const char *trade_coin = NULL;
-    const char *trade_price = NULL;
+    while (winner < 0 && failed < added) {
+        int running = 0;
+        curl_multi_perform(multi, &running);
 
+        CURLMsg *msg;
+        int pending;
+        while ((msg = curl_multi_info_read(multi, &pending))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            int i = msg->easy_handle == client->hedge[1];
+            if (msg->data.result == CURLE_OK) {
+                if (winner < 0) winner = i;
+            } else {
+                res = msg->data.result;
+                failed++;
+            }
+        }
+        if (winner >= 0 || failed == added) break;
 
-    if ((strcmp(command, "openallorder") == 0) || (strcmp(command, "open") == 0)) {
-        p_head();
-        format_table = 1;
-        snprintf(postdata, sizeof(postdata),
-                 "method=openOrders&timestamp=%ld&recvWindow=%ld",
-                 epoch_ms, recv_window);
-    } else if (strcmp(command, "openorder") == 0 && argc >= 3) {
-        p_head();
-        format_table = 1;
-        coin_pair_arg = argv[2];
-        snprintf(postdata, sizeof(postdata),
-                 "method=openOrders&timestamp=%ld&recvWindow=%ld&pair=%s_idr",
-                 epoch_ms, recv_window, coin_pair_arg);
-    } else if (strcmp(command, "buy") == 0 && argc >= 5) {
-        p_head();
-        is_trade = 1;
-        trade_coin = argv[2];
-        trade_price = argv[3];
-        snprintf(client_order_id, sizeof(client_order_id), "%sidr-%ld-idX", argv[2], t);
-        snprintf(postdata, sizeof(postdata),
-                 "method=trade&timestamp=%ld&recvWindow=%ld&pair=%s_idr&type=buy&price=%s&idr=%s&client_order_id=%s",
-                 epoch_ms, recv_window, argv[2], argv[3], argv[4], client_order_id);
-    } else if (strcmp(command, "sell") == 0 && argc >= 5) {
-        p_head();
-        is_trade = 1;
-        trade_coin = argv[2];
-        trade_price = argv[3];
-        snprintf(client_order_id, sizeof(client_order_id), "%sidr-%ld-idX", argv[2], t);
-        snprintf(postdata, sizeof(postdata),
-                 "method=trade&timestamp=%ld&recvWindow=%ld&pair=%s_idr&type=sell&price=%s&idr=%s&client_order_id=%s&%s=%s",
-                 epoch_ms, recv_window, argv[2], argv[3], argv[4], client_order_id, argv[2], argv[4]);
-    } else if (strcmp(command, "cancel") == 0 && argc >= 3) { 
-        p_head();
-        is_cancel = 1;
-        snprintf(postdata, sizeof(postdata),
-                 "method=cancelByClientOrderId&timestamp=%ld&recvWindow=%ld&client_order_id=%s",
-                 epoch_ms, recv_window, argv[2]);
-    } else if ( (strcmp(command, "getinfo") == 0) || (strcmp(command, "getInfo") == 0) ) {
-        p_head();
-        format_table = 1;
-        is_getinfo = 1;
-        snprintf(postdata, sizeof(postdata),
-                 "method=getInfo&timestamp=%ld&recvWindow=%ld",
-                 epoch_ms, recv_window); 
-    } else if (strcmp(command, "about") == 0) {
-        p_head();
-	printf("This program uses the Indodax REST API, a proof of concept (POC) demonstrating that we can create and utilize a REST API with C.\n\nIf you\'d like to give a gift, please send some DOGE to my wallet \"D6ckQMfcWSosY7J4rNQkY1rKX1pQTmNuTt\"\n\nOr if you\'re an Indodax user, you can send it using my username \"idban\" without the quotation marks.\n\n");
-	return 1;
-    } else {
-	p_head();
-        fprintf(stderr, "Invalid or insufficient arguments\n");
-        free(key);
-        free(secret);
-        curl_easy_cleanup(curl);
-        return 1;
+        uint64_t now = monotonic_us();
+        if (added == 1 && now >= deadline) {
+            curl_multi_add_handle(multi, client->hedge[1]);
+            added = 2;
+            continue;
+        }
+        int timeout_ms = added == 1 ? (int)((deadline - now) / 1000) + 1 : 1000;
+        curl_multi_poll(multi, NULL, 0, timeout_ms, NULL);
+    }
+
+    for (int i = 0; i < added; i++) curl_multi_remove_handle(multi, client->hedge[i]);
+    for (int i = 0; i < 2; i++) curl_easy_setopt(client->hedge[i], CURLOPT_HTTPHEADER, NULL);
+    if (client->timings && added == 2) {
+        fprintf(stderr, "{\"hedge\":\"%.*s\",\"delay_us\":%llu,\"winner\":%d}\n",
+                (int)strcspn(postdata + 7, "&"), postdata + 7, (unsigned long long)delay, winner);
+    }
+    if (winner < 0) return res;
+
+    struct MemoryStruct *won = &client->hedge_response[winner];
+    response_reset(&client->response, NULL);
+    if (won->memory && response_reserve(&client->response, won->size + 1)) {
+        memcpy(client->response.memory, won->memory, won->size + 1);
+        client->response.size = won->size;
     }
+    timings_from_curl(client->hedge[winner], timings);
+    conn_cache_note(client->hedge[winner], CURLE_OK);
+    return CURLE_OK;
+}
 
-    char signature[129] = {0};
-    hmac_sha512(postdata, secret, signature);
+// One signed attempt on client->curl (or hedged, for reads when enabled) into
+// client->response, or with stream straight to stdout. The handle is left
+// configured so a following call can reuse its connection and TLS session.
+static CURLcode tapi_attempt(struct tapi_client *client, const char *postdata, struct request_timings *timings,
+                             int stream) {
+    CURL *curl = client->curl;
+    enum method_class cls = method_class(postdata);
+    char signature[SIGN_HEX_LEN + 1];
+    limiter_wait(&client->limiter, cls);
+    uint64_t t0 = monotonic_us();
+    hmac_signer_sign(client->signer, postdata, strlen(postdata), signature);
+    timings->phase_us[PHASE_SIGN] = monotonic_us() - t0;
 
     struct curl_slist *headers = NULL;
     char key_hdr[MAX_HEADER], sign_hdr[MAX_HEADER];
-    snprintf(key_hdr, sizeof(key_hdr), "Key: %s", key);
+    snprintf(key_hdr, sizeof(key_hdr), "Key: %s", client->key);
     snprintf(sign_hdr, sizeof(sign_hdr), "Sign: %s", signature);
     headers = curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
     headers = curl_slist_append(headers, key_hdr);
     headers = curl_slist_append(headers, sign_hdr);
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://indodax.com/tapi");
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postdata);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    
-    struct MemoryStruct chunk;
-    chunk.memory = malloc(1);
-    chunk.size = 0;
+    CURLcode res;
+    if (cls == CLASS_READ && retry_policy()->hedge) {
+        res = hedged_perform(client, postdata, headers, timings);
+    } else {
+        retry_apply(curl, cls);
+        curl_easy_setopt(curl, CURLOPT_URL, client->tapi_url);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postdata);
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+        response_reset(&client->response, curl);
+        if (stream) {
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, out_stream_callback);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&client->out);
+        } else {
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&client->response);
+        }
+
+        res = curl_easy_perform(curl);
+        timings_from_curl(curl, timings);
+        conn_cache_note(curl, res);
+
+        // The header list must not outlive this call, so detach it from the handle
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
+    }
+    curl_slist_free_all(headers);
+    if (res == CURLE_OK && cls == CLASS_READ) retry_note_read(timings->phase_us[PHASE_TOTAL]);
+    return res;
+}
+
+// Sends one request into client->response under the call policy. Transient
+// failures are retried; a trade or cancel that may already have reached the
+// exchange is looked up by client_order_id first, and when the lookup shows it
+// took effect its reply (an "order" object) stands in for the original one.
+// With client->out.stream set the body goes to stdout as it arrives, and a
+// failure after part of it was written is not retried.
+CURLcode tapi_send(struct tapi_client *client, const char *postdata, struct request_timings *timings) {
+    const struct call_policy *p = retry_policy();
+    enum method_class cls = method_class(postdata);
+    int stream = client->out.stream;
+    CURLcode res = tapi_attempt(client, postdata, timings, stream);
+
+    for (int attempt = 0; res != CURLE_OK && retry_transient(res) && attempt < p->retries[cls]; attempt++) {
+        char lookup[SCHED_PAYLOAD];
+        if (client->out.streamed) break;
+        if (cls != CLASS_READ && !retry_unsent(res)) {
+            if (!retry_lookup_postdata(postdata, lookup, sizeof(lookup))) break;
+
+            // The lookup is a read and retries under the read budget
+            CURLcode lres = CURLE_OK;
+            for (int i = 0; i == 0 || (retry_transient(lres) && i <= p->retries[CLASS_READ]); i++) {
+                struct request_timings lt = {{0}};
+                lres = tapi_attempt(client, lookup, &lt, 0);
+                record_timings(client, lookup, &lt, lres == CURLE_OK);
+            }
+            enum lookup_outcome o = lres == CURLE_OK ?
+                retry_lookup_outcome(cls, client->response.memory, client->response.size) : LOOKUP_UNKNOWN;
+            if (o == LOOKUP_LANDED) {
+                fprintf(stderr, "(%s; confirmed by getOrderByClientOrderId, not re-sent)\n", curl_easy_strerror(res));
+                return CURLE_OK;
+            }
+            if (o == LOOKUP_UNKNOWN) break;
+        }
+        fprintf(stderr, "(%s; retrying)\n", curl_easy_strerror(res));
+        res = tapi_attempt(client, postdata, timings, stream);
+    }
+    return res;
+}
+
+// Sends one request and prints the response in the --output format, with one
+// write. Raw reads stream the body to stdout as it arrives; raw trades and
+// cancels are buffered so the order cache still learns about them.
+int perform_request(struct tapi_client *client, struct tapi_request *req) {
+    struct request_timings timings = {{0}};
+    struct MemoryStruct *chunk = &client->response;
+    struct output *out = &client->out;
+    int raw = out->format == OUTPUT_RAW;
+    out->stream = raw && (req->kind == RESP_ORDERS || req->kind == RESP_GETINFO);
+    out->streamed = 0;
+    CURLcode res = tapi_send(client, req->postdata, &timings);
+    out->stream = 0;
+    uint64_t t0 = monotonic_us();
+    if (raw && (out->streamed || (res == CURLE_OK && chunk->memory))) {
+        // A hedged read or a lookup reply arrives buffered even when streaming
+        if (!out->streamed) out_mem(&out->buf, chunk->memory, chunk->size);
+        out_mem(&out->buf, "\n", 1);
+        out_flush(out);
+    }
+    if (res != CURLE_OK) {
+        fprintf(stderr, "\nCURL error: %s\n", curl_easy_strerror(res));
+    } else if (raw && req->kind != RESP_TRADE && req->kind != RESP_CANCEL) {
+        // Already written, and only trades and cancels feed the order cache
+    } else if (!chunk->memory) {
+        fprintf(stderr, "Empty response\n");
+    } else {
+        switch (req->kind) {
+        case RESP_TRADE:
+            show_trade(client, chunk->memory, chunk->size, req->trade_coin, req->trade_price);
+            break;
+        case RESP_GETINFO:
+            format_getinfo_table(out, chunk->memory, chunk->size);
+            break;
+        case RESP_ORDERS:
+            show_orders(client, chunk->memory, chunk->size, req->coin_pair_arg);
+            break;
+        case RESP_CANCEL:
+            show_cancel(client, chunk->memory, chunk->size);
+            break;
+        default:
+            out_mem(&out->buf, chunk->memory, chunk->size);
+            out_mem(&out->buf, "\n", 1);
+        }
+        out_flush(out);
+    }
+    timings.phase_us[PHASE_PARSE] = monotonic_us() - t0;
+    record_timings(client, req->postdata, &timings, res == CURLE_OK);
+    return res == CURLE_OK;
+}
+
+// GET a public endpoint (path under base_url) into client->response on the
+// same handle as /tapi, so market data rides the already-open connection.
+int fetch_public(struct tapi_client *client, const char *path) {
+    CURL *curl = client->curl;
+    char url[MAX_LINE + 128];
+    snprintf(url, sizeof(url), "%s%s", client->base_url, path);
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    response_reset(&client->response, curl);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&client->response);
 
     CURLcode res = curl_easy_perform(curl);
+    conn_cache_note(curl, res);
+
+    struct request_timings timings;
+    char label[MAX_LINE];
+    memset(&timings, 0, sizeof(timings));
+    timings_from_curl(curl, &timings);
+    snprintf(label, sizeof(label), "method=%s", path);
+    record_timings(client, label, &timings, res == CURLE_OK);
+
     if (res != CURLE_OK) {
         fprintf(stderr, "\nCURL error: %s\n", curl_easy_strerror(res));
-    } else {
-        if (is_trade) {
-            format_trade_response_table(chunk.memory, trade_coin, trade_price);
-        } else if (format_table) {
-            if (is_getinfo) {
-                format_getinfo_table(chunk.memory);
-            } else {
-                format_orders_table(chunk.memory, coin_pair_arg);
-            }
-        } else if (is_cancel) { 
-            format_cancel_table(chunk.memory);
-        } else {
-            printf("%s\n", chunk.memory);
+        return 0;
+    }
+    if (!client->response.memory) {
+        fprintf(stderr, "Empty response\n");
+        return 0;
+    }
+    return 1;
+}
+
+int load_book(struct tapi_client *client, const char *coin, struct order_book *book, int with_trades) {
+    char path[128];
+    snprintf(book->pair, sizeof(book->pair), "%s_idr", coin);
+
+    snprintf(path, sizeof(path), "/api/depth/%sidr", coin);
+    if (!fetch_public(client, path) ||
+        !book_load_depth(book, client->response.memory, client->response.size)) {
+        return 0;
+    }
+
+    if (with_trades) {
+        snprintf(path, sizeof(path), "/api/trades/%sidr", coin);
+        if (fetch_public(client, path)) {
+            book_load_trades(book, client->response.memory, client->response.size);
         }
     }
+    return 1;
+}
 
-    free(chunk.memory);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    free(key);
-    free(secret);
-    return 0;
+// Pair rules (tick size, amount decimals, minimums) for checking orders before
+// they are signed. /api/pairs and /api/price_increments go out together; the
+// table is kept in indodax_pairs.cache for pairs_ttl seconds and, under
+// serve, in memory. With fetch unset only a cached table is used. Returns NULL,
+// after a warning, when the rules are unavailable: orders then go out unchecked.
+const struct pair_table *client_pairs(struct tapi_client *client, int fetch) {
+    time_t now = time(NULL);
+    if (client->pairs.count && now - client->pairs.fetched_at < client->pairs_ttl) return &client->pairs;
+    pairs_free(&client->pairs);
+    if (pairs_load(&client->pairs, PAIRS_CACHE_PATH, client->pairs_ttl)) return &client->pairs;
+    if (!fetch) return NULL;
+
+    CURLM *multi = client_multi(client, 2);
+    if (!multi) return NULL;
+    struct scheduler sched;
+    sched_init(&sched, multi, client->tapi_url, client->key, client->signer, &client->limiter, 2);
+
+    struct tapi_job jobs[2];
+    char urls[2][MAX_LINE + 32];
+    const char *paths[2] = { "/api/pairs", "/api/price_increments" };
+    memset(jobs, 0, sizeof(jobs));
+    for (int i = 0; i < 2; i++) {
+        snprintf(urls[i], sizeof(urls[i]), "%s%s", client->base_url, paths[i]);
+        jobs[i].url = urls[i];
+        sched_submit(&sched, &jobs[i]);
+    }
+    sched_run(&sched, NULL, NULL);
+
+    char err[192] = "";
+    for (int i = 0; i < 2 && !err[0]; i++) {
+        if (jobs[i].result != CURLE_OK) {
+            snprintf(err, sizeof(err), "CURL error: %s", curl_easy_strerror(jobs[i].result));
+        } else if (!jobs[i].response.memory) {
+            snprintf(err, sizeof(err), "Empty response");
+        }
+    }
+    if (!err[0]) {
+        pairs_parse(&client->pairs, jobs[0].response.memory, jobs[0].response.size,
+                    jobs[1].response.memory, jobs[1].response.size, err, sizeof(err));
+    }
+    response_free(&jobs[0].response);
+    response_free(&jobs[1].response);
+
+    if (err[0] || client->pairs.count == 0) {
+        fprintf(stderr, "Pair rules unavailable (%s), sending orders unchecked\n", err[0] ? err : "no IDR pairs");
+        pairs_free(&client->pairs);
+        return NULL;
+    }
+    if (client->pairs_ttl > 0) pairs_save(&client->pairs, PAIRS_CACHE_PATH);
+    return &client->pairs;
+}
+
+// Checks one order against its pair's rules and rewrites price and amount
+// (each a buffer of size bytes) to what will actually be sent. Adjustments
+// are noted on stderr under label; returns 0 with err set to reject.
+int check_order(const struct pair_table *pairs, const char *coin, const char *side, char *price, char *amount,
+                size_t size, const char *label, char *err, size_t errsize) {
+    if (!pairs) return 1;
+
+    const struct pair_info *p = pairs_find(pairs, coin);
+    if (!p) {
+        snprintf(err, errsize, "Unknown pair %s_idr", coin);
+        return 0;
+    }
+
+    dec64 px, amt;
+    if (!dec_parse(price, strlen(price), &px) || !dec_parse(amount, strlen(amount), &amt)) {
+        snprintf(err, errsize, "Invalid price or amount");
+        return 0;
+    }
+
+    dec64 orig_px = px, orig_amt = amt;
+    if (!pair_normalize(p, strcmp(side, "buy") == 0, &px, &amt, err, errsize)) return 0;
+
+    char a[DEC_STRLEN], t[DEC_STRLEN];
+    if (px != orig_px) {
+        fprintf(stderr, "%sprice %s snapped to %s (tick %s)\n", label, price, dec_format(px, a, sizeof(a)),
+                dec_format(p->tick, t, sizeof(t)));
+        dec_format(px, price, size);
+    }
+    if (amt != orig_amt) {
+        fprintf(stderr, "%samount %s truncated to %s\n", label, amount, dec_format(amt, a, sizeof(a)));
+        dec_format(amt, amount, size);
+    }
+    return 1;
+}
+
+// Turns "best", "best+N" or "best-N" into a price N ticks away from our side of
+// the book: best bid for buys, best ask for sells. The tick comes from the
+// pair rules, or is inferred from the book when they are unavailable.
+int resolve_best_price(struct tapi_client *client, const char *coin, const char *side,
+                       const char *spec, char *out, size_t size) {
+    char *end = (char *)spec + 4;
+    long ticks = 0;
+    if (spec[4]) {
+        if ((spec[4] == '+' || spec[4] == '-') && isdigit((unsigned char)spec[5])) ticks = strtol(spec + 4, &end, 10);
+        if (end == spec + 4 || *end) {
+            fprintf(stderr, "Invalid price '%s': expected best, best+N or best-N\n", spec);
+            return 0;
+        }
+    }
+
+    struct order_book book;
+    memset(&book, 0, sizeof(book));
+    if (!load_book(client, coin, &book, 0)) return 0;
+
+    int buy = strcmp(side, "buy") == 0;
+    const struct book_level *best = buy ? book_best_bid(&book) : book_best_ask(&book);
+    if (!best) {
+        fprintf(stderr, "No %s side in the %s book\n", buy ? "bid" : "ask", coin);
+        book_free(&book);
+        return 0;
+    }
+
+    const struct pair_table *pairs = client_pairs(client, 1);
+    const struct pair_info *p = pairs ? pairs_find(pairs, coin) : NULL;
+    if (p && p->tick > 0) book.tick = p->tick;
+    if (ticks != 0 && book.tick == 0) {
+        fprintf(stderr, "Cannot infer tick size from the %s book\n", coin);
+        book_free(&book);
+        return 0;
+    }
+
+    dec64 price = best->price + ticks * book.tick;
+    dec_format(price, out, size);
+    book_free(&book);
+    return price > 0;
+}
+
+// Measures our offset from the exchange clock (NTP-style, assuming the server
+// stamped its reply halfway through the round trip) and persists it.
+int run_sync_clock(struct tapi_client *client) {
+    int64_t sent = wall_ms() - clock_get_offset();
+    if (!fetch_public(client, "/api/server_time")) return 1;
+    int64_t received = wall_ms() - clock_get_offset();
+
+    struct json_view root, server_time;
+    size_t pos;
+    if (!jv_parse(client->response.memory, client->response.size, &root, &pos) || root.kind != JV_OBJECT) {
+        fprintf(stderr, "JSON error: invalid JSON near offset %zu\n", pos);
+        return 1;
+    }
+    char buf[32], *end = buf;
+    long long stamp = 0;
+    if (jv_object_get(&root, "server_time", &server_time) && server_time.kind == JV_NUMBER) {
+        stamp = strtoll(jv_copy(server_time.text, buf, sizeof(buf)), &end, 10);
+    }
+    if (end == buf || *end) {
+        fprintf(stderr, "Missing server_time\n");
+        return 1;
+    }
+
+    int64_t offset = (int64_t)stamp - (sent + received) / 2;
+
+    clock_set_offset(offset);
+    if (!clock_save_offset(CLOCK_OFFSET_PATH, offset)) return 1;
+    printf("Clock offset: %+lld ms (round trip %lld ms)\n", (long long)offset, (long long)(received - sent));
+    return 0;
+}
+
+int run_book(struct tapi_client *client, const char *coin, size_t levels) {
+    struct order_book book;
+    memset(&book, 0, sizeof(book));
+    if (!load_book(client, coin, &book, 1)) return 1;
+
+    const struct pair_table *pairs = client_pairs(client, 0);
+    const struct pair_info *p = pairs ? pairs_find(pairs, coin) : NULL;
+    if (p && p->tick > 0) book.tick = p->tick;
+
+    book_print(&book, levels);
+    book_free(&book);
+    return 0;
+}
+
+int run_vwap(struct tapi_client *client, const char *coin, const char *side, const char *size_arg) {
+    struct order_book book;
+    memset(&book, 0, sizeof(book));
+    if (!load_book(client, coin, &book, 0)) return 1;
+
+    dec64 filled, size = dec_from_str(size_arg);
+    dec64 vwap = book_vwap(&book, strcmp(side, "buy") == 0, size, &filled);
+    char v[32], f[32];
+    printf("VWAP to %s %s %s: %s", side, size_arg, coin, dec_format(vwap, v, sizeof(v)));
+    if (filled < size) printf(" (book only fills %s)", dec_format(filled, f, sizeof(f)));
+    printf("\n");
+
+    book_free(&book);
+    return 0;
+}
+
+struct batch_order {
+    char coin[32];
+    char side[8];
+    char price[32];
+    char amount[32];
+    char client_order_id[128];
+    char error[128];            // rejected before sending
+    struct tapi_job job;
+};
+
+// Reads "pair side price amount" lines. Blank lines and '#' comments are skipped.
+struct batch_order *read_batch_file(const char *path, size_t *count) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror("Error opening batch file");
+        return NULL;
+    }
+
+    struct batch_order *orders = NULL;
+    size_t n = 0, cap = 0;
+    char line[MAX_LINE];
+    int lineno = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        lineno++;
+        char pair[32], side[8], price[32], amount[32];
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\0') continue;
+
+        if (sscanf(p, "%31s %7s %31s %31s", pair, side, price, amount) != 4 ||
+            (strcmp(side, "buy") != 0 && strcmp(side, "sell") != 0)) {
+            fprintf(stderr, "%s:%d: expected <pair> <buy|sell> <price> <amount>\n", path, lineno);
+            continue;
+        }
+
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            struct batch_order *tmp = realloc(orders, cap * sizeof(*orders));
+            if (!tmp) {
+                fprintf(stderr, "Memory allocation error\n");
+                free(orders);
+                fclose(file);
+                return NULL;
+            }
+            orders = tmp;
+        }
+
+        struct batch_order *o = &orders[n++];
+        memset(o, 0, sizeof(*o));
+        char *coin = extract_coin_name(pair);
+        snprintf(o->coin, sizeof(o->coin), "%s", coin);
+        free(coin);
+        snprintf(o->side, sizeof(o->side), "%s", side);
+        snprintf(o->price, sizeof(o->price), "%s", price);
+        snprintf(o->amount, sizeof(o->amount), "%s", amount);
+    }
+    fclose(file);
+
+    *count = n;
+    return orders;
+}
+
+// Returns the client's multi handle, creating it on first use so serve keeps
+// its connections across batches.
+CURLM *client_multi(struct tapi_client *client, int max_inflight) {
+    if (!client->multi) {
+        client->multi = curl_multi_init();
+        if (!client->multi) {
+            fprintf(stderr, "curl multi init failed\n");
+            return NULL;
+        }
+        curl_multi_setopt(client->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    }
+    curl_multi_setopt(client->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)max_inflight);
+    return client->multi;
+}
+
+// Sends every order in the file through the scheduler with at most
+// max_inflight requests outstanding, then prints one result row per order.
+int run_batch(struct tapi_client *client, const char *path, int max_inflight) {
+    size_t count = 0;
+    struct batch_order *orders = read_batch_file(path, &count);
+    if (!orders) return 1;
+    if (count == 0) {
+        fprintf(stderr, "No orders in %s\n", path);
+        free(orders);
+        return 1;
+    }
+    if (max_inflight < 1) max_inflight = 1;
+
+    CURLM *multi = client_multi(client, max_inflight);
+    if (!multi) {
+        free(orders);
+        return 1;
+    }
+
+    // Off-tick prices snap to the nearest valid tick instead of coming back as
+    // rejections; orders that still break the rules are never sent
+    const struct pair_table *pairs = client_pairs(client, 1);
+    struct scheduler sched;
+    sched_init(&sched, multi, client->tapi_url, client->key, client->signer, &client->limiter, max_inflight);
+    for (size_t i = 0; i < count; i++) {
+        struct batch_order *o = &orders[i];
+        char label[32];
+        snprintf(label, sizeof(label), "#%zu: ", i + 1);
+        if (!check_order(pairs, o->coin, o->side, o->price, o->amount, sizeof(o->price), label,
+                         o->error, sizeof(o->error))) {
+            continue;
+        }
+        long epoch_ms = (long)nonce_ms();
+        long recv_window = epoch_ms + 49900000;
+        order_id_next(o->client_order_id, sizeof(o->client_order_id), o->coin);
+        build_trade_postdata(o->job.postdata, sizeof(o->job.postdata), o->side, o->coin, o->price, o->amount,
+                             o->client_order_id, epoch_ms, recv_window);
+        sched_submit(&sched, &o->job);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sched_run(&sched, NULL, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    struct order_cache cache;
+    int cached = client->cache_ttl > 0 && order_cache_open(&cache, CACHE_PATH);
+
+    int ok = 0;
+    printf("+-------+------------+------+-----------------+-------------------+-----------------------------+--------------------------------+\n");
+    printf("| #     | Coin Name  | Side | Price           | Remaining Amount  | Client Order ID             | Status                         |\n");
+    printf("+-------+------------+------+-----------------+-------------------+-----------------------------+--------------------------------+\n");
+    for (size_t i = 0; i < count; i++) {
+        struct batch_order *o = &orders[i];
+        struct tapi_job *job = &o->job;
+        struct trade_row row;
+        const char *status;
+        int accepted = 0;
+        uint64_t t0 = monotonic_us();
+
+        memset(&row, 0, sizeof(row));
+        if (o->error[0]) {
+            printf("| %-5zu | %-10s | %-4s | %-15s | %-17s | %-27s | %-30.30s |\n",
+                   i + 1, o->coin, o->side, o->price, "N/A", "N/A", o->error);
+            continue;
+        }
+        if (job->result != CURLE_OK) {
+            snprintf(row.error, sizeof(row.error), "CURL error: %s", curl_easy_strerror(job->result));
+            status = row.error;
+        } else if (job->response.memory && parse_trade_response(job->response.memory, job->response.size, o->coin, &row)) {
+            status = job->landed ? "OK (confirmed by lookup)" : "OK";
+            accepted = 1;
+            ok++;
+            if (cached) cache_apply_trade(&cache, &row, o->coin, o->price);
+        } else {
+            status = row.error;
+        }
+        job->timings.phase_us[PHASE_PARSE] = monotonic_us() - t0;
+        record_timings(client, job->postdata, &job->timings, accepted);
+
+        printf("| %-5zu | %-10s | %-4s | %-15s | %-17s | %-27s | %-30.30s |\n",
+               i + 1, o->coin, o->side, o->price, row.remain[0] ? row.remain : "N/A",
+               o->client_order_id, status);
+        response_free(&job->response);
+    }
+    printf("+-------+------------+------+-----------------+-------------------+-----------------------------+--------------------------------+\n");
+
+    double elapsed_ms = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    if (cached) order_cache_close(&cache);
+
+    printf("%d/%zu orders accepted in %.1f ms (%.1f orders/s)\n",
+           ok, count, elapsed_ms, elapsed_ms > 0 ? count * 1000.0 / elapsed_ms : 0.0);
+    if (client->timings && client->metrics) {
+        metrics_dump(stderr, client->metrics, client->metrics_format);
+    }
+
+    free(orders);
+    return ok == (int)count ? 0 : 1;
+}
+
+struct cancel_order {
+    char coin[32];
+    char type[8];
+    char price[32];
+    char client_order_id[128];
+    struct tapi_job job;
+};
+
+struct cancel_list {
+    struct cancel_order *items;
+    size_t count;
+    size_t cap;
+    int skipped;            // orders placed without a client_order_id
+    const char *coin;       // only this coin's orders, NULL for all
+};
+
+static void collect_cancel_row(const struct order_row *row, void *ctx) {
+    struct cancel_list *list = ctx;
+    // Never trust the server-side pair filter alone with a mass cancel
+    if (list->coin && strcmp(row->coin, list->coin) != 0) return;
+    if (strcmp(row->client_order_id, "N/A") == 0) {
+        list->skipped++;
+        return;
+    }
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 64;
+        struct cancel_order *tmp = realloc(list->items, cap * sizeof(*tmp));
+        if (!tmp) {
+            fprintf(stderr, "Memory allocation error\n");
+            return;
+        }
+        list->items = tmp;
+        list->cap = cap;
+    }
+    struct cancel_order *o = &list->items[list->count++];
+    memset(o, 0, sizeof(*o));
+    snprintf(o->coin, sizeof(o->coin), "%s", row->coin);
+    snprintf(o->type, sizeof(o->type), "%s", row->type);
+    snprintf(o->price, sizeof(o->price), "%s", row->price);
+    snprintf(o->client_order_id, sizeof(o->client_order_id), "%s", row->client_order_id);
+}
+
+// Fetches openOrders once (for one coin, or all pairs when coin is NULL), then
+// cancels every order concurrently on the same multi handle and prints one row
+// per order with the wall time from the fetch to the last reply.
+int run_cancelall(struct tapi_client *client, const char *coin, int max_inflight) {
+    CURLM *multi = client_multi(client, max_inflight);
+    if (!multi) return 1;
+
+    struct scheduler sched;
+    sched_init(&sched, multi, client->tapi_url, client->key, client->signer, &client->limiter, max_inflight);
+
+    struct timespec start, listed, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    struct tapi_job fetch;
+    memset(&fetch, 0, sizeof(fetch));
+    long epoch_ms = (long)nonce_ms();
+    if (coin) {
+        snprintf(fetch.postdata, sizeof(fetch.postdata),
+                 "method=openOrders&timestamp=%ld&recvWindow=%ld&pair=%s_idr",
+                 epoch_ms, epoch_ms + 49900000, coin);
+    } else {
+        snprintf(fetch.postdata, sizeof(fetch.postdata),
+                 "method=openOrders&timestamp=%ld&recvWindow=%ld",
+                 epoch_ms, epoch_ms + 49900000);
+    }
+    sched_submit(&sched, &fetch);
+    sched_run(&sched, NULL, NULL);
+    record_timings(client, fetch.postdata, &fetch.timings, fetch.result == CURLE_OK);
+
+    if (fetch.result != CURLE_OK) {
+        fprintf(stderr, "\nCURL error: %s\n", curl_easy_strerror(fetch.result));
+        response_free(&fetch.response);
+        return 1;
+    }
+    struct json_view orders;
+    if (!fetch.response.memory || !load_orders(fetch.response.memory, fetch.response.size, &orders)) {
+        response_free(&fetch.response);
+        return 1;
+    }
+    struct cancel_list list = { NULL, 0, 0, 0, NULL };
+    char *coin_name = coin ? extract_coin_name(coin) : NULL;
+    list.coin = coin_name;
+    walk_orders(&orders, coin, collect_cancel_row, &list);
+    free(coin_name);
+    response_free(&fetch.response);
+    clock_gettime(CLOCK_MONOTONIC, &listed);
+
+    if (list.skipped) {
+        fprintf(stderr, "%d open orders have no client_order_id and were left alone\n", list.skipped);
+    }
+    if (list.count == 0) {
+        printf("No open orders to cancel\n");
+        free(list.items);
+        return 0;
+    }
+
+    for (size_t i = 0; i < list.count; i++) {
+        struct cancel_order *o = &list.items[i];
+        epoch_ms = (long)nonce_ms();
+        build_cancel_postdata(o->job.postdata, sizeof(o->job.postdata), o->client_order_id,
+                              epoch_ms, epoch_ms + 49900000);
+        sched_submit(&sched, &o->job);
+    }
+    sched_run(&sched, NULL, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    struct order_cache cache;
+    int cached = client->cache_ttl > 0 && order_cache_open(&cache, CACHE_PATH);
+
+    int ok = 0;
+    printf("+-------+------------+------+-----------------+-----------------------------+--------------------------------+\n");
+    printf("| #     | Coin Name  | Type | Price           | Client Order ID             | Status                         |\n");
+    printf("+-------+------------+------+-----------------+-----------------------------+--------------------------------+\n");
+    for (size_t i = 0; i < list.count; i++) {
+        struct cancel_order *o = &list.items[i];
+        struct tapi_job *job = &o->job;
+        struct cancel_row row;
+        const char *status;
+        int cancelled = 0;
+        uint64_t t0 = monotonic_us();
+
+        if (job->result != CURLE_OK) {
+            snprintf(row.error, sizeof(row.error), "CURL error: %s", curl_easy_strerror(job->result));
+            status = row.error;
+        } else if (job->response.memory && parse_cancel_response(job->response.memory, job->response.size, &row)) {
+            status = job->landed ? "Cancelled (confirmed by lookup)" : "Cancelled";
+            cancelled = 1;
+            ok++;
+            if (cached) order_cache_remove(&cache, o->client_order_id);
+        } else {
+            status = row.error;
+        }
+        job->timings.phase_us[PHASE_PARSE] = monotonic_us() - t0;
+        record_timings(client, job->postdata, &job->timings, cancelled);
+
+        printf("| %-5zu | %-10s | %-4s | %-15s | %-27s | %-30.30s |\n",
+               i + 1, o->coin, o->type, o->price, o->client_order_id, status);
+        response_free(&job->response);
+    }
+    printf("+-------+------------+------+-----------------+-----------------------------+--------------------------------+\n");
+    if (cached) order_cache_close(&cache);
+
+    double list_ms = (listed.tv_sec - start.tv_sec) * 1000.0 + (listed.tv_nsec - start.tv_nsec) / 1e6;
+    double elapsed_ms = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    printf("%d/%zu orders cancelled in %.1f ms (openOrders %.1f ms)\n", ok, list.count, elapsed_ms, list_ms);
+    if (client->timings && client->metrics) {
+        metrics_dump(stderr, client->metrics, client->metrics_format);
+    }
+
+    free(list.items);
+    return ok == (int)list.count ? 0 : 1;
+}
+
+struct account_fetch {
+    struct account_client *acct;
+    struct tapi_job job;
+    struct json_view ret;               // the reply's "return", valid until job.response is freed
+    char error[192];                    // empty on success
+};
+
+// Sends the same read for every selected account at once, each signed with
+// and metered against its own key, and checks every reply.
+static struct account_fetch *fetch_accounts(struct tapi_client *client, struct scheduler *sched,
+                                            const char *method, const char *params) {
+    struct account_fetch *f = calloc(client->naccounts, sizeof(*f));
+    if (!f) {
+        fprintf(stderr, "Memory allocation error\n");
+        return NULL;
+    }
+
+    for (int i = 0; i < client->naccounts; i++) {
+        struct account_client *a = &client->accounts[i];
+        long epoch_ms = (long)nonce_ms();
+        f[i].acct = a;
+        f[i].job.key = a->key;
+        f[i].job.signer = &a->signer;
+        f[i].job.limiter = &a->limiter;
+        snprintf(f[i].job.postdata, sizeof(f[i].job.postdata), "method=%s&timestamp=%ld&recvWindow=%ld%s",
+                 method, epoch_ms, epoch_ms + 49900000, params);
+        sched_submit(sched, &f[i].job);
+    }
+    sched_run(sched, NULL, NULL);
+
+    for (int i = 0; i < client->naccounts; i++) {
+        struct tapi_job *job = &f[i].job;
+        record_timings(client, job->postdata, &job->timings, job->result == CURLE_OK);
+        if (job->result != CURLE_OK) {
+            snprintf(f[i].error, sizeof(f[i].error), "CURL error: %s", curl_easy_strerror(job->result));
+        } else if (!job->response.memory) {
+            snprintf(f[i].error, sizeof(f[i].error), "Empty response");
+        } else {
+            tapi_check_response(job->response.memory, job->response.size, &f[i].ret, f[i].error, sizeof(f[i].error));
+        }
+    }
+    return f;
+}
+
+static void free_account_fetch(struct account_fetch *f, int n) {
+    for (int i = 0; f && i < n; i++) response_free(&f[i].job.response);
+    free(f);
+}
+
+static int accounts_inflight(const struct tapi_client *client) {
+    return client->naccounts > BATCH_INFLIGHT ? client->naccounts : BATCH_INFLIGHT;
+}
+
+static double elapsed_since(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+struct account_balances {
+    const char *account;
+    int assets;
+    dec64 idr_available;
+    dec64 idr_hold;
+};
+
+static void print_account_balance_row(struct strview asset, const struct json_view *available,
+                                      const struct json_view *hold, void *ctx) {
+    struct account_balances *t = ctx;
+    char name[32], avail_str[DEC_STRLEN], hold_str[DEC_STRLEN];
+    dec64 avail_value = available ? json_value_to_dec(available) : 0;
+    dec64 hold_value = hold ? json_value_to_dec(hold) : 0;
+    if (avail_value <= 0 && hold_value <= 0) return;
+
+    jv_copy(asset, name, sizeof(name));
+    printf("| %-12s | %-10s | %-17s | %-17s |\n", t->account, name,
+           dec_format(avail_value, avail_str, sizeof(avail_str)), dec_format(hold_value, hold_str, sizeof(hold_str)));
+    t->assets++;
+    if (strcmp(name, "idr") == 0) {
+        t->idr_available += avail_value;
+        t->idr_hold += hold_value;
+    }
+}
+
+// getInfo for every selected account in one round trip: one merged balance
+// table, then a line per account with its asset count and IDR.
+int run_accounts_getinfo(struct tapi_client *client) {
+    CURLM *multi = client_multi(client, accounts_inflight(client));
+    if (!multi) return 1;
+    struct scheduler sched;
+    sched_init(&sched, multi, client->tapi_url, client->key, client->signer, &client->limiter, accounts_inflight(client));
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct account_fetch *f = fetch_accounts(client, &sched, "getInfo", "");
+    if (!f) return 1;
+    double fetch_ms = elapsed_since(&start);
+
+    struct account_balances *totals = calloc(client->naccounts, sizeof(*totals));
+    if (!totals) {
+        fprintf(stderr, "Memory allocation error\n");
+        free_account_fetch(f, client->naccounts);
+        return 1;
+    }
+
+    printf("+--------------+------------+-------------------+-------------------+\n");
+    printf("| Account      | Asset      | Available Balance | On Hold Balance   |\n");
+    printf("+--------------+------------+-------------------+-------------------+\n");
+    for (int i = 0; i < client->naccounts; i++) {
+        struct json_view balance, hold;
+        totals[i].account = f[i].acct->name;
+        if (f[i].error[0]) continue;
+        if (!tapi_find_balances(&f[i].ret, &balance, &hold)) {
+            snprintf(f[i].error, sizeof(f[i].error), "Missing balance information");
+            continue;
+        }
+        tapi_walk_balances(&balance, &hold, print_account_balance_row, &totals[i]);
+    }
+    printf("+--------------+------------+-------------------+-------------------+\n\n");
+
+    int failed = 0;
+    char a[DEC_STRLEN], h[DEC_STRLEN];
+    printf("+--------------+--------+-------------------+-------------------+--------------------------------+\n");
+    printf("| Account      | Assets | IDR Available     | IDR On Hold       | Status                         |\n");
+    printf("+--------------+--------+-------------------+-------------------+--------------------------------+\n");
+    for (int i = 0; i < client->naccounts; i++) {
+        printf("| %-12s | %6d | %17s | %17s | %-30.30s |\n", totals[i].account, totals[i].assets,
+               dec_format(totals[i].idr_available, a, sizeof(a)), dec_format(totals[i].idr_hold, h, sizeof(h)),
+               f[i].error[0] ? f[i].error : "OK");
+        if (f[i].error[0]) failed++;
+    }
+    printf("+--------------+--------+-------------------+-------------------+--------------------------------+\n");
+    printf("%d accounts in %.1f ms\n", client->naccounts, fetch_ms);
+
+    free(totals);
+    free_account_fetch(f, client->naccounts);
+    return failed ? 1 : 0;
+}
+
+struct account_orders {
+    const char *account;
+    int buys;
+    int sells;
+};
+
+static void print_account_order_row(const struct order_row *row, void *ctx) {
+    struct account_orders *t = ctx;
+    printf("| %-12s | %-10s | %-15s | %-17s | %-27s | %-4s |\n", t->account, row->coin, row->price,
+           row->remain, row->client_order_id, row->type);
+    if (strcmp(row->type, "buy") == 0) t->buys++;
+    else t->sells++;
+}
+
+// openOrders (all pairs, or coin_pair) for every selected account at once,
+// merged into one table with per-account counts. The local order cache
+// belongs to the default account and is left alone.
+int run_accounts_orders(struct tapi_client *client, const char *coin_pair) {
+    CURLM *multi = client_multi(client, accounts_inflight(client));
+    if (!multi) return 1;
+    struct scheduler sched;
+    sched_init(&sched, multi, client->tapi_url, client->key, client->signer, &client->limiter, accounts_inflight(client));
+
+    char params[64] = "";
+    if (coin_pair) snprintf(params, sizeof(params), "&pair=%s_idr", coin_pair);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct account_fetch *f = fetch_accounts(client, &sched, "openOrders", params);
+    if (!f) return 1;
+    double fetch_ms = elapsed_since(&start);
+
+    struct account_orders *totals = calloc(client->naccounts, sizeof(*totals));
+    if (!totals) {
+        fprintf(stderr, "Memory allocation error\n");
+        free_account_fetch(f, client->naccounts);
+        return 1;
+    }
+
+    printf("+--------------+------------+-----------------+-------------------+-----------------------------+------+\n");
+    printf("| Account      | Coin Name  | Price           | Open/Remain Order | Client Order ID             | type |\n");
+    printf("+--------------+------------+-----------------+-------------------+-----------------------------+------+\n");
+    for (int i = 0; i < client->naccounts; i++) {
+        struct json_view orders;
+        totals[i].account = f[i].acct->name;
+        if (f[i].error[0]) continue;
+        if (!jv_object_get(&f[i].ret, "orders", &orders)) {
+            snprintf(f[i].error, sizeof(f[i].error), "Missing 'orders' object");
+            continue;
+        }
+        walk_orders(&orders, coin_pair, print_account_order_row, &totals[i]);
+    }
+    printf("+--------------+------------+-----------------+-------------------+-----------------------------+------+\n\n");
+
+    int failed = 0;
+    printf("+--------------+--------+--------+--------+--------------------------------+\n");
+    printf("| Account      | Orders | Buy    | Sell   | Status                         |\n");
+    printf("+--------------+--------+--------+--------+--------------------------------+\n");
+    for (int i = 0; i < client->naccounts; i++) {
+        const struct account_orders *t = &totals[i];
+        printf("| %-12s | %6d | %6d | %6d | %-30.30s |\n", t->account, t->buys + t->sells, t->buys, t->sells,
+               f[i].error[0] ? f[i].error : "OK");
+        if (f[i].error[0]) failed++;
+    }
+    printf("+--------------+--------+--------+--------+--------------------------------+\n");
+    printf("%d accounts in %.1f ms\n", client->naccounts, fetch_ms);
+
+    free(totals);
+    free_account_fetch(f, client->naccounts);
+    return failed ? 1 : 0;
+}
+
+// cancelall across accounts: every account's openOrders at once, then every
+// cancel at once, each request under its own account's key and rate limits.
+int run_accounts_cancelall(struct tapi_client *client, const char *coin) {
+    CURLM *multi = client_multi(client, accounts_inflight(client));
+    if (!multi) return 1;
+    struct scheduler sched;
+    sched_init(&sched, multi, client->tapi_url, client->key, client->signer, &client->limiter, accounts_inflight(client));
+
+    char params[64] = "";
+    if (coin) snprintf(params, sizeof(params), "&pair=%s_idr", coin);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct account_fetch *f = fetch_accounts(client, &sched, "openOrders", params);
+    if (!f) return 1;
+    double list_ms = elapsed_since(&start);
+
+    struct cancel_list *lists = calloc(client->naccounts, sizeof(*lists));
+    if (!lists) {
+        fprintf(stderr, "Memory allocation error\n");
+        free_account_fetch(f, client->naccounts);
+        return 1;
+    }
+
+    char *coin_name = coin ? extract_coin_name(coin) : NULL;
+    size_t total = 0;
+    for (int i = 0; i < client->naccounts; i++) {
+        struct json_view orders;
+        struct account_client *a = f[i].acct;
+        lists[i].coin = coin_name;
+        if (f[i].error[0]) continue;
+        if (!jv_object_get(&f[i].ret, "orders", &orders)) {
+            snprintf(f[i].error, sizeof(f[i].error), "Missing 'orders' object");
+            continue;
+        }
+        walk_orders(&orders, coin, collect_cancel_row, &lists[i]);
+        if (lists[i].skipped) {
+            fprintf(stderr, "%s: %d open orders have no client_order_id and were left alone\n", a->name, lists[i].skipped);
+        }
+        for (size_t j = 0; j < lists[i].count; j++) {
+            struct tapi_job *job = &lists[i].items[j].job;
+            long epoch_ms = (long)nonce_ms();
+            job->key = a->key;
+            job->signer = &a->signer;
+            job->limiter = &a->limiter;
+            build_cancel_postdata(job->postdata, sizeof(job->postdata), lists[i].items[j].client_order_id,
+                                  epoch_ms, epoch_ms + 49900000);
+            sched_submit(&sched, job);
+        }
+        total += lists[i].count;
+    }
+    free(coin_name);
+    sched_run(&sched, NULL, NULL);
+    double elapsed_ms = elapsed_since(&start);
+
+    int *cancelled = calloc(client->naccounts, sizeof(*cancelled));
+    int ok = 0, failed = 0;
+    if (total) {
+        printf("+--------------+------------+------+-----------------+-----------------------------+--------------------------------+\n");
+        printf("| Account      | Coin Name  | Type | Price           | Client Order ID             | Status                         |\n");
+        printf("+--------------+------------+------+-----------------+-----------------------------+--------------------------------+\n");
+    }
+    for (int i = 0; i < client->naccounts; i++) {
+        for (size_t j = 0; j < lists[i].count; j++) {
+            struct cancel_order *o = &lists[i].items[j];
+            struct tapi_job *job = &o->job;
+            struct cancel_row row;
+            const char *status;
+            int done = 0;
+
+            if (job->result != CURLE_OK) {
+                snprintf(row.error, sizeof(row.error), "CURL error: %s", curl_easy_strerror(job->result));
+                status = row.error;
+            } else if (job->response.memory && parse_cancel_response(job->response.memory, job->response.size, &row)) {
+                status = job->landed ? "Cancelled (confirmed by lookup)" : "Cancelled";
+                done = 1;
+            } else {
+                status = row.error;
+            }
+            record_timings(client, job->postdata, &job->timings, done);
+            if (done && cancelled) cancelled[i]++;
+            ok += done;
+
+            printf("| %-12s | %-10s | %-4s | %-15s | %-27s | %-30.30s |\n",
+                   f[i].acct->name, o->coin, o->type, o->price, o->client_order_id, status);
+            response_free(&job->response);
+        }
+    }
+    if (total) {
+        printf("+--------------+------------+------+-----------------+-----------------------------+--------------------------------+\n\n");
+    }
+
+    printf("+--------------+--------+-----------+--------------------------------+\n");
+    printf("| Account      | Orders | Cancelled | Status                         |\n");
+    printf("+--------------+--------+-----------+--------------------------------+\n");
+    for (int i = 0; i < client->naccounts; i++) {
+        int n = cancelled ? cancelled[i] : 0;
+        printf("| %-12s | %6zu | %9d | %-30.30s |\n", f[i].acct->name, lists[i].count, n,
+               f[i].error[0] ? f[i].error : (n == (int)lists[i].count ? "OK" : "Incomplete"));
+        if (f[i].error[0]) failed++;
+        free(lists[i].items);
+    }
+    printf("+--------------+--------+-----------+--------------------------------+\n");
+    printf("%d/%zu orders cancelled across %d accounts in %.1f ms (openOrders %.1f ms)\n",
+           ok, total, client->naccounts, elapsed_ms, list_ms);
+
+    free(cancelled);
+    free(lists);
+    free_account_fetch(f, client->naccounts);
+    return failed || ok != (int)total ? 1 : 0;
+}
+
+struct pair_sync {
+    char pair[24];
+    char coin[16];
+    int index;              // the pair's slot in the history store
+    int64_t from_id;
+    size_t added;
+    int pages;
+    char error[192];
+    struct tapi_job job;
+};
+
+struct history_sync {
+    struct tapi_client *client;
+    struct history_store *store;
+    struct scheduler *sched;
+    struct history_row rows[HISTORY_PAGE];
+};
+
+static void history_page_postdata(struct pair_sync *p) {
+    long epoch_ms = (long)nonce_ms();
+    snprintf(p->job.postdata, sizeof(p->job.postdata),
+             "method=tradeHistory&timestamp=%ld&recvWindow=%ld&pair=%s&count=%d&order=asc&from_id=%lld",
+             epoch_ms, epoch_ms + 49900000, p->pair, HISTORY_PAGE, (long long)p->from_id);
+}
+
+static int64_t view_to_int64(struct strview v) {
+    int64_t n = 0;
+    for (size_t i = 0; v.ptr && i < v.len && v.ptr[i] >= '0' && v.ptr[i] <= '9'; i++) {
+        n = n * 10 + (v.ptr[i] - '0');
+    }
+    return n;
+}
+
+static int cmp_row_id(const void *a, const void *b) {
+    int64_t x = ((const struct history_row *)a)->id, y = ((const struct history_row *)b)->id;
+    return (x > y) - (x < y);
+}
+
+// Appends the fills on one tradeHistory page that are newer than the pair's
+// last stored id, then queues the next page if this one was full.
+static void history_page_done(struct tapi_job *job, void *ctx) {
+    struct history_sync *sync = ctx;
+    struct pair_sync *p = job->user;
+    struct json_view ret, trades, trade;
+    record_timings(sync->client, job->postdata, &job->timings, job->result == CURLE_OK);
+
+    if (job->result != CURLE_OK) {
+        snprintf(p->error, sizeof(p->error), "CURL error: %s", curl_easy_strerror(job->result));
+        return;
+    }
+    if (!job->response.memory) {
+        snprintf(p->error, sizeof(p->error), "Empty response");
+        return;
+    }
+    if (!tapi_check_response(job->response.memory, job->response.size, &ret, p->error, sizeof(p->error))) return;
+    if (!jv_object_get(&ret, "trades", &trades) || trades.kind != JV_ARRAY) {
+        snprintf(p->error, sizeof(p->error), "Missing 'trades' array");
+        return;
+    }
+
+    int64_t last_id = sync->store->hdr->pairs[p->index].last_id;
+    int64_t page_max = 0;
+    size_t n = 0, seen = 0;
+    struct json_iter it;
+    jv_iter_init(&it, &trades);
+    while (jv_array_next(&it, &trade) > 0) {
+        if (trade.kind != JV_OBJECT) continue;
+        struct history_row row;
+        memset(&row, 0, sizeof(row));
+
+        struct json_iter fields;
+        struct strview key;
+        struct json_view value;
+        jv_iter_init(&fields, &trade);
+        while (jv_object_next(&fields, &key, &value) > 0) {
+            if (value.kind != JV_STRING && value.kind != JV_NUMBER) continue;
+            if (sv_eq(key, "trade_id")) row.id = view_to_int64(value.text);
+            else if (sv_eq(key, "type")) row.side = sv_eq(value.text, "sell");
+            else if (sv_eq(key, "price")) dec_parse(value.text.ptr, value.text.len, &row.price);
+            else if (sv_eq(key, "fee")) dec_parse(value.text.ptr, value.text.len, &row.fee);
+            else if (sv_eq(key, "trade_time")) row.time = view_to_int64(value.text);
+            else if (sv_eq(key, p->coin)) dec_parse(value.text.ptr, value.text.len, &row.amount);
+        }
+
+        seen++;
+        if (row.id > page_max) page_max = row.id;
+        if (row.id > last_id && n < HISTORY_PAGE) sync->rows[n++] = row;
+    }
+
+    qsort(sync->rows, n, sizeof(sync->rows[0]), cmp_row_id);
+    if (!history_append(sync->store, p->index, sync->rows, n)) {
+        snprintf(p->error, sizeof(p->error), "Cannot write %s", HISTORY_DIR);
+        return;
+    }
+    p->added += n;
+    p->pages++;
+
+    if (seen >= HISTORY_PAGE && page_max >= p->from_id) {
+        p->from_id = page_max + 1;
+        history_page_postdata(p);
+        sched_submit(sync->sched, job);
+    }
+}
+
+struct pair_list {
+    struct pair_sync *items;
+    size_t count;
+};
+
+static void add_sync_pair(struct pair_list *list, const char *coin) {
+    char pair[24];
+    size_t n = strlen(coin);
+    int has_suffix = n > 4 && strcmp(coin + n - 4, "_idr") == 0;
+    snprintf(pair, sizeof(pair), "%s%s", coin, has_suffix ? "" : "_idr");
+
+    for (size_t i = 0; i < list->count; i++) {
+        if (strcmp(list->items[i].pair, pair) == 0) return;
+    }
+    if (list->count >= HISTORY_MAX_PAIRS) return;
+
+    struct pair_sync *p = &list->items[list->count++];
+    memset(p, 0, sizeof(*p));
+    snprintf(p->pair, sizeof(p->pair), "%s", pair);
+    snprintf(p->coin, sizeof(p->coin), "%.*s", (int)(strlen(pair) - 4), pair);
+}
+
+static void add_balance_pair(struct strview asset, const struct json_view *available,
+                             const struct json_view *hold, void *ctx) {
+    char coin[16];
+    jv_copy(asset, coin, sizeof(coin));
+    if (strcmp(coin, "idr") == 0) return;
+    if ((available && json_value_to_dec(available) > 0) || (hold && json_value_to_dec(hold) > 0)) {
+        add_sync_pair(ctx, coin);
+    }
+}
+
+// Pairs to sync when none are named: every pair already in the store plus
+// every coin getInfo shows a balance for.
+static int default_sync_pairs(struct tapi_client *client, struct scheduler *sched,
+                              struct history_store *store, struct pair_list *list) {
+    for (uint32_t i = 0; i < store->hdr->npairs; i++) {
+        add_sync_pair(list, store->hdr->pairs[i].name);
+    }
+
+    struct tapi_job info;
+    memset(&info, 0, sizeof(info));
+    long epoch_ms = (long)nonce_ms();
+    snprintf(info.postdata, sizeof(info.postdata), "method=getInfo&timestamp=%ld&recvWindow=%ld",
+             epoch_ms, epoch_ms + 49900000);
+    sched_submit(sched, &info);
+    sched_run(sched, NULL, NULL);
+    record_timings(client, info.postdata, &info.timings, info.result == CURLE_OK);
+
+    struct json_view ret, balance, hold;
+    char err[192];
+    int ok = 0;
+    if (info.result != CURLE_OK) {
+        fprintf(stderr, "\nCURL error: %s\n", curl_easy_strerror(info.result));
+    } else if (!info.response.memory ||
+               !tapi_check_response(info.response.memory, info.response.size, &ret, err, sizeof(err))) {
+        fprintf(stderr, "%s\n", info.response.memory ? err : "Empty response");
+    } else if (!tapi_find_balances(&ret, &balance, &hold)) {
+        fprintf(stderr, "Missing balance information\n");
+    } else {
+        tapi_walk_balances(&balance, &hold, add_balance_pair, list);
+        ok = 1;
+    }
+    response_free(&info.response);
+    return ok;
+}
+
+// Pages tradeHistory for each pair from just after its last stored trade,
+// all pairs in parallel, appending every page to the columnar store as it lands.
+int run_sync_history(struct tapi_client *client, int ncoins, char *coins[]) {
+    struct history_store store;
+    if (!history_open(&store, HISTORY_DIR)) return 1;
+
+    CURLM *multi = client_multi(client, BATCH_INFLIGHT);
+    struct history_sync *sync = malloc(sizeof(*sync));
+    struct pair_list list = { calloc(HISTORY_MAX_PAIRS, sizeof(struct pair_sync)), 0 };
+    if (!multi || !sync || !list.items) {
+        if (multi) fprintf(stderr, "Memory allocation error\n");
+        free(sync);
+        free(list.items);
+        history_close(&store);
+        return 1;
+    }
+
+    struct scheduler sched;
+    sched_init(&sched, multi, client->tapi_url, client->key, client->signer, &client->limiter, BATCH_INFLIGHT);
+    sync->client = client;
+    sync->store = &store;
+    sync->sched = &sched;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int ok = 1;
+    for (int i = 0; i < ncoins; i++) add_sync_pair(&list, coins[i]);
+    if (ncoins == 0) ok = default_sync_pairs(client, &sched, &store, &list);
+
+    for (size_t i = 0; ok && i < list.count; i++) {
+        struct pair_sync *p = &list.items[i];
+        p->index = history_pair(&store, p->pair);
+        if (p->index < 0) {
+            snprintf(p->error, sizeof(p->error), "History full (%d pairs)", HISTORY_MAX_PAIRS);
+            continue;
+        }
+        p->from_id = store.hdr->pairs[p->index].last_id + 1;
+        p->job.user = p;
+        history_page_postdata(p);
+        sched_submit(&sched, &p->job);
+    }
+    if (ok) sched_run(&sched, history_page_done, sync);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    size_t added = 0;
+    int failed = 0;
+    if (ok) {
+        store.hdr->synced_at = time(NULL);
+        printf("+------------+------------+-------+-----------------+--------------------------------+\n");
+        printf("| Pair       | New Trades | Pages | Last Trade ID   | Status                         |\n");
+        printf("+------------+------------+-------+-----------------+--------------------------------+\n");
+        for (size_t i = 0; i < list.count; i++) {
+            struct pair_sync *p = &list.items[i];
+            long long last = p->index >= 0 ? (long long)store.hdr->pairs[p->index].last_id : 0;
+            printf("| %-10s | %10zu | %5d | %15lld | %-30.30s |\n", p->pair, p->added, p->pages, last,
+                   p->error[0] ? p->error : "OK");
+            added += p->added;
+            if (p->error[0]) failed++;
+            response_free(&p->job.response);
+        }
+        printf("+------------+------------+-------+-----------------+--------------------------------+\n");
+
+        double elapsed_ms = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+        printf("%zu new trades across %zu pairs in %.1f ms (%llu stored)\n",
+               added, list.count, elapsed_ms, (unsigned long long)store.hdr->rows);
+    }
+
+    history_close(&store);
+    free(list.items);
+    free(sync);
+    return ok && !failed ? 0 : 1;
+}
+
+struct pair_stats {
+    uint64_t trades;
+    dec128 bought, sold;            // coin amounts, 8 decimals
+    dec128 buy_notional;            // amount * price, 16 decimals
+    dec128 sell_notional;
+    dec128 position;                // coin still held from recorded buys
+    dec128 cost;                    // cost basis of position, 16 decimals
+    dec128 realized;                // 16 decimals
+};
+
+static dec64 average_price(dec128 notional, dec128 amount) {
+    return amount ? (dec64)(notional / amount) : 0;
+}
+
+// Volume, average prices and realized P&L per pair from one pass over the
+// pair, side, price, amount and fee columns. P&L uses average cost; sells
+// beyond the recorded buys are left out of it, and fees count as IDR.
+int run_history(const char *coin) {
+    struct history_store store;
+    if (!history_open(&store, HISTORY_DIR)) return 1;
+    if (!history_map(&store)) {
+        history_close(&store);
+        return 1;
+    }
+
+    int only = -1;
+    if (coin) {
+        char pair[24];
+        size_t n = strlen(coin);
+        snprintf(pair, sizeof(pair), "%s%s", coin, n > 4 && strcmp(coin + n - 4, "_idr") == 0 ? "" : "_idr");
+        for (uint32_t i = 0; i < store.hdr->npairs; i++) {
+            if (strcmp(store.hdr->pairs[i].name, pair) == 0) only = (int)i;
+        }
+        if (only < 0) {
+            fprintf(stderr, "No history for %s, run sync-history %s first\n", pair, coin);
+            history_close(&store);
+            return 1;
+        }
+    }
+
+    struct pair_stats *stats = calloc(store.hdr->npairs + 1, sizeof(*stats));
+    if (!stats) {
+        fprintf(stderr, "Memory allocation error\n");
+        history_close(&store);
+        return 1;
+    }
+
+    uint64_t t0 = monotonic_us();
+    const int64_t *pair = store.col[HCOL_PAIR], *side = store.col[HCOL_SIDE];
+    const int64_t *price = store.col[HCOL_PRICE], *amount = store.col[HCOL_AMOUNT], *fee = store.col[HCOL_FEE];
+    for (size_t i = 0; i < store.mapped_rows; i++) {
+        if (only >= 0 && pair[i] != only) continue;
+        if (pair[i] < 0 || pair[i] >= (int64_t)store.hdr->npairs) continue;
+        struct pair_stats *st = &stats[pair[i]];
+        dec128 notional = (dec128)amount[i] * price[i];
+        st->trades++;
+        st->realized -= (dec128)fee[i] * DEC_SCALE;
+
+        if (side[i] == 0) {
+            st->bought += amount[i];
+            st->buy_notional += notional;
+            st->position += amount[i];
+            st->cost += notional;
+        } else {
+            st->sold += amount[i];
+            st->sell_notional += notional;
+            dec128 covered = amount[i] < st->position ? amount[i] : st->position;
+            if (covered > 0) {
+                dec128 basis = st->cost * covered / st->position;
+                st->realized += covered * price[i] - basis;
+                st->cost -= basis;
+                st->position -= covered;
+            }
+        }
+    }
+    uint64_t scan_us = monotonic_us() - t0;
+
+    char b[DEC_STRLEN], ab[DEC_STRLEN], s[DEC_STRLEN], as[DEC_STRLEN], pnl[DEC_STRLEN];
+    printf("+------------+----------+-------------------+-------------------+-------------------+-------------------+-------------------+\n");
+    printf("| Pair       | Trades   | Bought            | Avg Buy Price     | Sold              | Avg Sell Price    | Realized P&L IDR  |\n");
+    printf("+------------+----------+-------------------+-------------------+-------------------+-------------------+-------------------+\n");
+    for (uint32_t i = 0; i < store.hdr->npairs; i++) {
+        const struct pair_stats *st = &stats[i];
+        if (!st->trades) continue;
+        printf("| %-10s | %8llu | %17s | %17s | %17s | %17s | %17s |\n", store.hdr->pairs[i].name,
+               (unsigned long long)st->trades,
+               dec128_format(st->bought, b, sizeof(b)),
+               dec_format(average_price(st->buy_notional, st->bought), ab, sizeof(ab)),
+               dec128_format(st->sold, s, sizeof(s)),
+               dec_format(average_price(st->sell_notional, st->sold), as, sizeof(as)),
+               dec128_format(st->realized / DEC_SCALE, pnl, sizeof(pnl)));
+    }
+    printf("+------------+----------+-------------------+-------------------+-------------------+-------------------+-------------------+\n");
+    printf("Scanned %zu trades in %.1f ms", store.mapped_rows, scan_us / 1000.0);
+    if (store.hdr->synced_at) printf(", last sync %lds ago", (long)(time(NULL) - store.hdr->synced_at));
+    printf("\n");
+
+    free(stats);
+    history_close(&store);
+    return 0;
+}
+
+struct holding {
+    char asset[16];
+    dec64 amount;           // available plus on hold
+};
+
+struct holding_list {
+    struct holding *items;
+    size_t count;
+    size_t cap;
+    int sorted;
+};
+
+static void collect_holding(struct strview asset, const struct json_view *available,
+                            const struct json_view *hold, void *ctx) {
+    struct holding_list *list = ctx;
+    dec64 amount = (available ? json_value_to_dec(available) : 0) + (hold ? json_value_to_dec(hold) : 0);
+    if (amount <= 0) return;
+
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 64;
+        struct holding *tmp = realloc(list->items, cap * sizeof(*tmp));
+        if (!tmp) {
+            fprintf(stderr, "Memory allocation error\n");
+            return;
+        }
+        list->items = tmp;
+        list->cap = cap;
+    }
+    struct holding *h = &list->items[list->count];
+    jv_copy(asset, h->asset, sizeof(h->asset));
+    h->amount = amount;
+    if (list->count > 0 && strcmp(h[-1].asset, h->asset) >= 0) list->sorted = 0;
+    list->count++;
+}
+
+static int cmp_holding(const void *a, const void *b) {
+    return strcmp(((const struct holding *)a)->asset, ((const struct holding *)b)->asset);
+}
+
+// Fills price[i] with the IDR price of holdings[i] by merging the two
+// asset-sorted arrays: one pass, no per-row lookups. -1 marks no IDR market.
+static void join_prices(const struct holding_list *holdings, const struct ticker_table *tickers, dec64 *price) {
+    size_t j = 0;
+    for (size_t i = 0; i < holdings->count; i++) {
+        const char *asset = holdings->items[i].asset;
+        if (strcmp(asset, "idr") == 0) {
+            price[i] = DEC_SCALE;
+            continue;
+        }
+        int c = 1;
+        while (j < tickers->count && (c = strcmp(tickers->items[j].asset, asset)) < 0) j++;
+        price[i] = j < tickers->count && c == 0 ? tickers->items[j].last : -1;
+    }
+}
+
+// Values every non-zero balance in IDR at the last traded price. getInfo and
+// /api/ticker_all go out together on the multi handle, so a cold run costs one
+// round trip; a ticker snapshot younger than ticker_ttl is read from disk.
+int run_portfolio(struct tapi_client *client) {
+    CURLM *multi = client_multi(client, 2);
+    if (!multi) return 1;
+
+    struct scheduler sched;
+    sched_init(&sched, multi, client->tapi_url, client->key, client->signer, &client->limiter, 2);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    struct ticker_table tickers;
+    int cached = ticker_load(&tickers, TICKER_CACHE_PATH, client->ticker_ttl);
+
+    struct tapi_job info, ticker_job;
+    char ticker_url[MAX_LINE + 32];
+    memset(&info, 0, sizeof(info));
+    memset(&ticker_job, 0, sizeof(ticker_job));
+    long epoch_ms = (long)nonce_ms();
+    snprintf(info.postdata, sizeof(info.postdata), "method=getInfo&timestamp=%ld&recvWindow=%ld",
+             epoch_ms, epoch_ms + 49900000);
+    sched_submit(&sched, &info);
+    if (!cached) {
+        snprintf(ticker_url, sizeof(ticker_url), "%s/api/ticker_all", client->base_url);
+        ticker_job.url = ticker_url;
+        sched_submit(&sched, &ticker_job);
+    }
+    sched_run(&sched, NULL, NULL);
+    record_timings(client, info.postdata, &info.timings, info.result == CURLE_OK);
+
+    char err[192];
+    int ok = 1;
+    if (!cached) {
+        if (ticker_job.result != CURLE_OK) {
+            fprintf(stderr, "\nCURL error: %s\n", curl_easy_strerror(ticker_job.result));
+            ok = 0;
+        } else if (!ticker_job.response.memory ||
+                   !ticker_parse(&tickers, ticker_job.response.memory, ticker_job.response.size, err, sizeof(err))) {
+            fprintf(stderr, "%s\n", ticker_job.response.memory ? err : "Empty response");
+            ok = 0;
+        } else {
+            ticker_save(&tickers, TICKER_CACHE_PATH);
+        }
+        response_free(&ticker_job.response);
+    }
+
+    struct json_view ret, balance, hold;
+    struct holding_list holdings = { NULL, 0, 0, 1 };
+    if (info.result != CURLE_OK) {
+        fprintf(stderr, "\nCURL error: %s\n", curl_easy_strerror(info.result));
+        ok = 0;
+    } else if (!info.response.memory ||
+               !tapi_check_response(info.response.memory, info.response.size, &ret, err, sizeof(err))) {
+        fprintf(stderr, "%s\n", info.response.memory ? err : "Empty response");
+        ok = 0;
+    } else if (!tapi_find_balances(&ret, &balance, &hold)) {
+        fprintf(stderr, "Missing balance information\n");
+        ok = 0;
+    } else {
+        tapi_walk_balances(&balance, &hold, collect_holding, &holdings);
+    }
+    response_free(&info.response);
+
+    dec64 *price = ok ? malloc((holdings.count + 1) * sizeof(*price)) : NULL;
+    if (ok && !price) {
+        fprintf(stderr, "Memory allocation error\n");
+        ok = 0;
+    }
+    if (!ok) {
+        free(holdings.items);
+        ticker_free(&tickers);
+        return 1;
+    }
+
+    if (!holdings.sorted) qsort(holdings.items, holdings.count, sizeof(*holdings.items), cmp_holding);
+    join_prices(&holdings, &tickers, price);
+
+    dec128 total = 0;
+    size_t unpriced = 0;
+    for (size_t i = 0; i < holdings.count; i++) {
+        if (price[i] >= 0) total += (dec128)holdings.items[i].amount * price[i] / DEC_SCALE;
+        else unpriced++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    char a[DEC_STRLEN], p[DEC_STRLEN], v[DEC_STRLEN];
+    printf("+------------+-------------------+-------------------+-------------------+---------+\n");
+    printf("| Asset      | Balance           | Last Price (IDR)  | Value (IDR)       | Share   |\n");
+    printf("+------------+-------------------+-------------------+-------------------+---------+\n");
+    for (size_t i = 0; i < holdings.count; i++) {
+        const struct holding *h = &holdings.items[i];
+        if (price[i] < 0) {
+            printf("| %-10s | %17s | %17s | %17s | %7s |\n", h->asset,
+                   dec_format(h->amount, a, sizeof(a)), "N/A", "N/A", "-");
+            continue;
+        }
+        dec128 value = (dec128)h->amount * price[i] / DEC_SCALE;
+        printf("| %-10s | %17s | %17s | %17s | %6.2f%% |\n", h->asset,
+               dec_format(h->amount, a, sizeof(a)), dec_format(price[i], p, sizeof(p)),
+               dec128_format(value, v, sizeof(v)), total > 0 ? (double)value * 100.0 / (double)total : 0.0);
+    }
+    if (holdings.count == 0) {
+        printf("| No balances found with non-zero values                                           |\n");
+    }
+    printf("+------------+-------------------+-------------------+-------------------+---------+\n");
+    printf("| %-10s | %17s | %17s | %17s | %7s |\n", "Total", "", "", dec128_format(total, v, sizeof(v)), "100%");
+    printf("+------------+-------------------+-------------------+-------------------+---------+\n");
+
+    double elapsed_ms = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    printf("%zu assets in %.1f ms, tickers ", holdings.count, elapsed_ms);
+    if (cached) printf("cached %lds ago", (long)(time(NULL) - tickers.fetched_at));
+    else printf("fetched");
+    if (unpriced) printf(", %zu without an IDR market", unpriced);
+    printf("\n");
+
+    free(price);
+    free(holdings.items);
+    ticker_free(&tickers);
+    return 0;
+}
+
+static volatile sig_atomic_t watch_stop = 0;
+
+static void watch_signal(int sig) {
+    (void)sig;
+    watch_stop = 1;
+}
+
+struct watch_state {
+    struct tapi_client *client;
+    int balances;
+    char stamp[16];             // HH:MM:SS of the current poll
+    int64_t now_ms;
+};
+
+// What became of an order that left openOrders: one getOrder on the same
+// connection. "closed" when the exchange won't say.
+static const char *closed_status(struct tapi_client *client, const struct watch_row *row, char *buf, size_t size) {
+    struct request_timings timings = {{0}};
+    char postdata[SCHED_PAYLOAD];
+    long epoch_ms = (long)nonce_ms();
+    snprintf(postdata, sizeof(postdata), "method=getOrder&timestamp=%ld&recvWindow=%ld&pair=%s&order_id=%s",
+             epoch_ms, epoch_ms + 49900000, row->pair, row->key);
+    CURLcode res = tapi_send(client, postdata, &timings);
+    record_timings(client, postdata, &timings, res == CURLE_OK);
+
+    struct json_view ret, order, status;
+    char err[192];
+    if (res != CURLE_OK || !client->response.memory ||
+        !tapi_check_response(client->response.memory, client->response.size, &ret, err, sizeof(err)) ||
+        !jv_object_get(&ret, "order", &order) || !jv_object_get(&order, "status", &status) ||
+        status.kind != JV_STRING) {
+        return "closed";
+    }
+    jv_copy(status.text, buf, size);
+    return buf;
+}
+
+static void print_watch_event(enum watch_change change, const struct watch_row *prev,
+                              const struct watch_row *cur, void *ctx) {
+    struct watch_state *w = ctx;
+    const struct watch_row *row = cur ? cur : prev;
+    char status[32];
+
+    if (w->balances) {
+        const char *from = prev ? prev->amount : "0", *to = cur ? cur->amount : "0";
+        const char *hold_from = prev ? prev->hold : "0", *hold_to = cur ? cur->hold : "0";
+        if (w->client->out.format == OUTPUT_JSONL) {
+            static const char *const fields[] = { "event", "asset", "available", "prev_available", "hold", "prev_hold" };
+            const char *values[] = { "balance", row->key, to, from, hold_to, hold_from };
+            out_event(&w->client->out, (long long)w->now_ms, fields, values, 6);
+        } else {
+            printf("%s balance   %-10s available %s -> %s  hold %s -> %s\n", w->stamp, row->key, from, to, hold_from, hold_to);
+        }
+        return;
+    }
+
+    const char *event;
+    switch (change) {
+    case WATCH_NEW: event = "new"; break;
+    case WATCH_CHANGED: event = strcmp(prev->amount, cur->amount) != 0 ? "partial" : "changed"; break;
+    default: event = closed_status(w->client, prev, status, sizeof(status)); break;
+    }
+
+    if (w->client->out.format == OUTPUT_JSONL) {
+        static const char *const fields[] = { "event", "pair", "type", "price", "remain", "prev_remain",
+                                              "order_id", "client_order_id" };
+        const char *values[] = { event, row->pair, row->type, row->price, cur ? cur->amount : "0",
+                                 prev ? prev->amount : NULL, row->key, row->client_order_id };
+        out_event(&w->client->out, (long long)w->now_ms, fields, values, 8);
+    } else {
+        printf("%s %-9s %-10s %-4s price %-15s remain ", w->stamp, event, row->pair, row->type, row->price);
+        if (prev && cur) printf("%s -> %s", prev->amount, cur->amount);
+        else printf("%s", row->amount);
+        printf("  %s\n", row->client_order_id[0] ? row->client_order_id : row->key);
+    }
+}
+
+// Polls openOrders (or getInfo) on the one connection and prints only what
+// changed since the previous poll. The interval drops to watch_min_ms after a
+// change and doubles up to watch_max_ms while nothing moves; it never goes
+// below what rate_read allows. Runs until interrupted.
+int run_watch(struct tapi_client *client, const char *what, const char *coin_pair) {
+    int balances = strcmp(what, "getInfo") == 0 || strcmp(what, "getinfo") == 0;
+    if (!balances && strcmp(what, "open") != 0) {
+        fprintf(stderr, "watch takes open [coin] or getInfo\n");
+        return 1;
+    }
+
+    int min_ms = client->watch_min_ms > 0 ? client->watch_min_ms : 1;
+    double read_rate = client->limiter.bucket[CLASS_READ].rate;
+    if (read_rate > 0 && min_ms < 1000 / read_rate) min_ms = (int)(1000 / read_rate);
+    int max_ms = client->watch_max_ms > min_ms ? client->watch_max_ms : min_ms;
+
+    char pair[64];
+    char params[80] = "";
+    if (coin_pair) {
+        size_t n = strlen(coin_pair);
+        snprintf(pair, sizeof(pair), "%s%s", coin_pair, n > 4 && strcmp(coin_pair + n - 4, "_idr") == 0 ? "" : "_idr");
+        snprintf(params, sizeof(params), "&pair=%s", pair);
+    }
+
+    watch_stop = 0;
+    signal(SIGINT, watch_signal);
+    signal(SIGTERM, watch_signal);
+
+    struct watch_snapshot snaps[2];
+    memset(snaps, 0, sizeof(snaps));
+    struct watch_snapshot *prev = &snaps[0], *cur = &snaps[1];
+    struct watch_state w = { client, balances, "", 0 };
+    int have_prev = 0, interval = min_ms;
+    long polls = 0, events = 0;
+
+    while (!watch_stop) {
+        struct request_timings timings = {{0}};
+        char postdata[SCHED_PAYLOAD], err[192];
+        long epoch_ms = (long)nonce_ms();
+        snprintf(postdata, sizeof(postdata), "method=%s&timestamp=%ld&recvWindow=%ld%s",
+                 balances ? "getInfo" : "openOrders", epoch_ms, epoch_ms + 49900000, balances ? "" : params);
+        CURLcode res = tapi_send(client, postdata, &timings);
+        polls++;
+
+        uint64_t t0 = monotonic_us();
+        struct json_view ret, orders;
+        int ok = res == CURLE_OK && client->response.memory &&
+                 tapi_check_response(client->response.memory, client->response.size, &ret, err, sizeof(err));
+        if (res != CURLE_OK) snprintf(err, sizeof(err), "CURL error: %s", curl_easy_strerror(res));
+        else if (!client->response.memory) snprintf(err, sizeof(err), "Empty response");
+        if (ok && balances) {
+            ok = watch_snapshot_balances(cur, &ret);
+            if (!ok) snprintf(err, sizeof(err), "Missing balance information");
+        } else if (ok) {
+            ok = jv_object_get(&ret, "orders", &orders) && watch_snapshot_orders(cur, &orders, coin_pair ? pair : NULL);
+            if (!ok) snprintf(err, sizeof(err), "Unknown 'orders' format in JSON response");
+        }
+        timings.phase_us[PHASE_PARSE] = monotonic_us() - t0;
+        record_timings(client, postdata, &timings, ok);
+
+        if (!ok) {
+            // Keep the last good snapshot and try again later
+            fprintf(stderr, "%s\n", err);
+            interval = interval * 2 < max_ms ? interval * 2 : max_ms;
+        } else if (!have_prev) {
+            fprintf(stderr, "Watching %zu %s (polling every %d-%d ms, Ctrl-C to stop)\n", cur->count,
+                    balances ? "balances" : "open orders", min_ms, max_ms);
+            have_prev = 1;
+        } else {
+            time_t now = time(NULL);
+            strftime(w.stamp, sizeof(w.stamp), "%H:%M:%S", localtime(&now));
+            w.now_ms = wall_ms();
+            size_t changes = watch_diff(prev, cur, print_watch_event, &w);
+            events += changes;
+            out_flush(&client->out);
+            interval = changes ? min_ms : (interval * 2 < max_ms ? interval * 2 : max_ms);
+        }
+        if (ok) {
+            struct watch_snapshot *tmp = prev;
+            prev = cur;
+            cur = tmp;
+        }
+
+        struct timespec ts = { interval / 1000, (long)(interval % 1000) * 1000000 };
+        while (!watch_stop && nanosleep(&ts, &ts) != 0) {}
+    }
+
+    fprintf(stderr, "%ld polls, %ld events\n", polls, events);
+    if (client->timings && client->metrics) {
+        metrics_dump(stderr, client->metrics, client->metrics_format);
+    }
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    watch_snapshot_free(&snaps[0]);
+    watch_snapshot_free(&snaps[1]);
+    return 0;
+}
+
+// The commands that print a single /tapi result, which --output applies to
+static int single_result_command(const char *command) {
+    static const char *commands[] = { "open", "openallorder", "openorder", "getInfo", "getinfo", "buy", "sell", "cancel" };
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        if (strcmp(command, commands[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+int run_command(struct tapi_client *client, int argc, char *argv[]) {
+    struct tapi_request req;
+
+    if (strcmp(argv[1], "about") == 0) {
+        p_head();
+	printf("This program uses the Indodax REST API, a proof of concept (POC) demonstrating that we can create and utilize a REST API with C.\n\nIf you\'d like to give a gift, please send some DOGE to my wallet \"D6ckQMfcWSosY7J4rNQkY1rKX1pQTmNuTt\"\n\nOr if you\'re an Indodax user, you can send it using my username \"idban\" without the quotation marks.\n\n");
+	return 1;
+    }
+
+    // Machine-readable, so no banner
+    if (strcmp(argv[1], "metrics") == 0) {
+        if (!client->metrics) {
+            fprintf(stderr, "Metrics are only collected by serve or with --timings\n");
+            return 1;
+        }
+        enum metrics_format format = client->metrics_format;
+        if (argc >= 3) format = strcmp(argv[2], "prom") == 0 ? METRICS_PROMETHEUS : METRICS_JSON;
+        metrics_dump(stdout, client->metrics, format);
+        return 0;
+    }
+
+    // Events only, so scripts can follow stdout
+    if (strcmp(argv[1], "watch") == 0 && argc >= 3) {
+        if (client->out.format != OUTPUT_TABLE && client->out.format != OUTPUT_JSONL) {
+            fprintf(stderr, "watch prints text or --output jsonl\n");
+            return 1;
+        }
+        return run_watch(client, argv[2], argc >= 4 ? argv[3] : NULL);
+    }
+
+    // Machine-readable output carries the result alone, without the banner
+    if (client->out.format == OUTPUT_TABLE) {
+        p_head();
+    } else if (client->naccounts > 0 || !single_result_command(argv[1])) {
+        fprintf(stderr, "--output %s applies to open, openorder, getInfo, buy, sell and cancel\n",
+                output_name(client->out.format));
+        return 1;
+    }
+    if (client->naccounts > 0) {
+        if (strcmp(argv[1], "getInfo") == 0 || strcmp(argv[1], "getinfo") == 0) {
+            return run_accounts_getinfo(client);
+        }
+        if (strcmp(argv[1], "open") == 0 || strcmp(argv[1], "openallorder") == 0) {
+            return run_accounts_orders(client, NULL);
+        }
+        if (strcmp(argv[1], "openorder") == 0 && argc >= 3) {
+            return run_accounts_orders(client, argv[2]);
+        }
+        if (strcmp(argv[1], "cancelall") == 0) {
+            return run_accounts_cancelall(client, argc >= 3 ? argv[2] : NULL);
+        }
+        fprintf(stderr, "--accounts only applies to getInfo, open, openorder and cancelall\n");
+        return 1;
+    }
+
+    if (strcmp(argv[1], "batch") == 0 && argc >= 3) {
+        return run_batch(client, argv[2], argc >= 4 ? atoi(argv[3]) : BATCH_INFLIGHT);
+    }
+
+    if (strcmp(argv[1], "cancelall") == 0) {
+        return run_cancelall(client, argc >= 3 ? argv[2] : NULL, BATCH_INFLIGHT);
+    }
+
+    if (strcmp(argv[1], "portfolio") == 0) {
+        return run_portfolio(client);
+    }
+
+    if (strcmp(argv[1], "sync-history") == 0) {
+        return run_sync_history(client, argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "history") == 0) {
+        return run_history(argc >= 3 ? argv[2] : NULL);
+    }
+
+    if (strcmp(argv[1], "sync-clock") == 0) {
+        return run_sync_clock(client);
+    }
+    if (strcmp(argv[1], "book") == 0 && argc >= 3) {
+        return run_book(client, argv[2], argc >= 4 ? (size_t)atoi(argv[3]) : BOOK_LEVELS);
+    }
+    if (strcmp(argv[1], "vwap") == 0 && argc >= 5) {
+        return run_vwap(client, argv[2], argv[3], argv[4]);
+    }
+
+    char best_price[32];
+    if ((strcmp(argv[1], "buy") == 0 || strcmp(argv[1], "sell") == 0) && argc >= 5 &&
+        strncmp(argv[3], "best", 4) == 0) {
+        if (!resolve_best_price(client, argv[2], argv[1], argv[3], best_price, sizeof(best_price))) {
+            return 1;
+        }
+        argv[3] = best_price;
+    }
+
+    // Checked and normalized here, so a bad tick or a too-small order never
+    // costs a round trip
+    char price[32], amount[32];
+    if ((strcmp(argv[1], "buy") == 0 || strcmp(argv[1], "sell") == 0) && argc >= 5) {
+        char err[128];
+        snprintf(price, sizeof(price), "%s", argv[3]);
+        snprintf(amount, sizeof(amount), "%s", argv[4]);
+        if (!check_order(client_pairs(client, 1), argv[2], argv[1], price, amount, sizeof(price), "", err, sizeof(err))) {
+            fprintf(stderr, "Order rejected: %s\n", err);
+            return 1;
+        }
+        argv[3] = price;
+        argv[4] = amount;
+    }
+
+    if (!build_request(argc, argv, &req)) {
+        fprintf(stderr, "Invalid or insufficient arguments\n");
+        return 1;
+    }
+
+    if (req.kind == RESP_ORDERS && print_cached_orders(client, req.coin_pair_arg)) {
+        return 0;
+    }
+
+    perform_request(client, &req);
+    return 0;
+}
+
+static volatile sig_atomic_t serve_stop = 0;
+
+static void serve_signal(int sig) {
+    (void)sig;
+    serve_stop = 1;
+}
+
+// Reads one NUL-separated argument list from a client. The first slot is left
+// for the program name so the result can be handed to run_command as argv.
+int read_client_args(int fd, char *buf, size_t size, char *args[], int max_args) {
+    size_t len = 0;
+    ssize_t n;
+
+    while (len < size - 1 && (n = read(fd, buf + len, size - 1 - len)) > 0) {
+        len += n;
+    }
+    if (len == 0) return 0;
+    buf[len] = '\0';
+
+    int nargs = 1;
+    char *p = buf;
+    while (p < buf + len && nargs < max_args - 1) {
+        args[nargs++] = p;
+        p += strlen(p) + 1;
+    }
+    args[nargs] = NULL;
+    return nargs;
+}
+
+// Daemon mode: one CURL handle lives for the whole process so keep-alive
+// connections and TLS sessions to /tapi survive between client requests.
+int serve(const char *path, struct tapi_client *client) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return 1;
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    // The socket can place orders with our key, keep it private to this user
+    mode_t old_mask = umask(0077);
+    int rc = bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_mask);
+    if (rc < 0 || listen(listen_fd, 16) < 0) {
+        perror("bind/listen");
+        close(listen_fd);
+        return 1;
+    }
+
+    CURL *curl = client->curl;
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 30L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 15L);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = serve_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Keep stdout and stderr interleaved in order once both point at a client
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    fprintf(stderr, "Listening on %s\n", path);
+
+    int serve_verify = client->verify;
+
+    while (!serve_stop) {
+        int client_fd = accept(listen_fd, NULL, NULL);
+        if (client_fd < 0) {
+            if (errno != EINTR) perror("accept");
+            continue;
+        }
+
+        // A stuck client must not wedge the daemon for everyone else
+        struct timeval tv = { 2, 0 };
+        setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        char buf[MAX_REQUEST];
+        char *args[MAX_ARGS];
+        args[0] = "indodax_api";
+        int nargs = read_client_args(client_fd, buf, sizeof(buf), args, MAX_ARGS);
+        char **argv = args;
+        client->out.format = OUTPUT_TABLE;
+        client->verify = serve_verify;
+        // Options remote forwards ahead of the command, for this request only
+        while (nargs >= 3) {
+            if (strcmp(argv[1], "--verify") == 0) {
+                client->verify = 1;
+            } else if (strncmp(argv[1], "--output=", 9) != 0 || !output_parse(argv[1] + 9, &client->out.format)) {
+                break;
+            }
+            argv++;
+            argv[0] = args[0];
+            nargs--;
+        }
+        if (nargs < 2) {
+            close(client_fd);
+            continue;
+        }
+
+        // Route the formatters' stdout/stderr to the client for this request
+        fflush(stdout);
+        fflush(stderr);
+        int saved_out = dup(STDOUT_FILENO);
+        int saved_err = dup(STDERR_FILENO);
+        dup2(client_fd, STDOUT_FILENO);
+        dup2(client_fd, STDERR_FILENO);
+
+        // A watch never returns, and would hold the daemon hostage
+        if (strcmp(argv[1], "watch") == 0) {
+            fprintf(stderr, "watch only runs one-shot, not through serve\n");
+        } else {
+            run_command(client, nargs, argv);
+        }
+
+        fflush(stdout);
+        fflush(stderr);
+        dup2(saved_out, STDOUT_FILENO);
+        dup2(saved_err, STDERR_FILENO);
+        close(saved_out);
+        close(saved_err);
+        close(client_fd);
+    }
+
+    close(listen_fd);
+    unlink(path);
+    return 0;
+}
+
+// Client side of serve: forwards argv to the daemon and copies its reply to
+// stdout. A non-table output format and --verify go ahead of the command.
+int remote_command(const char *path, int argc, char *argv[], enum output_format format, int verify) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return 1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Cannot connect to %s: %s\n", path, strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    char output_opt[32];
+    snprintf(output_opt, sizeof(output_opt), "--output=%s", output_name(format));
+    if ((format != OUTPUT_TABLE && write(fd, output_opt, strlen(output_opt) + 1) < 0) ||
+        (verify && write(fd, "--verify", sizeof("--verify")) < 0)) {
+        perror("write");
+        close(fd);
+        return 1;
+    }
+    for (int i = 0; i < argc; i++) {
+        if (write(fd, argv[i], strlen(argv[i]) + 1) < 0) {
+            perror("write");
+            close(fd);
+            return 1;
+        }
+    }
+    shutdown(fd, SHUT_WR);
+
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        fwrite(buf, 1, n, stdout);
+    }
+    close(fd);
+    return 0;
+}
+
+// Resolves --accounts ("all" or a comma list of section names) against the
+// config. Unknown names fail here, before anything is sent.
+static int select_accounts(const struct config *cfg, const char *spec, struct account_client **out, int *count) {
+    struct account_client *sel = calloc(MAX_ACCOUNTS, sizeof(*sel));
+    int n = 0;
+    if (!sel) {
+        fprintf(stderr, "Memory allocation error\n");
+        return 0;
+    }
+
+    if (strcmp(spec, "all") == 0) {
+        for (int i = 0; i < cfg->naccounts; i++) {
+            sel[n].name = cfg->accounts[i].name;
+            sel[n].key = cfg->accounts[i].key;
+            n++;
+        }
+    } else {
+        char buf[MAX_ACCOUNTS * 33];
+        char *save = NULL;
+        snprintf(buf, sizeof(buf), "%s", spec);
+        for (char *name = strtok_r(buf, ",", &save); name; name = strtok_r(NULL, ",", &save)) {
+            int found = -1, dup = 0;
+            for (int i = 0; i < cfg->naccounts; i++) {
+                if (strcmp(cfg->accounts[i].name, name) == 0) found = i;
+            }
+            if (found < 0) {
+                fprintf(stderr, "Unknown account %s\n", name);
+                free(sel);
+                return 0;
+            }
+            for (int j = 0; j < n; j++) {
+                if (sel[j].name == cfg->accounts[found].name) dup = 1;
+            }
+            if (dup) continue;
+            sel[n].name = cfg->accounts[found].name;
+            sel[n].key = cfg->accounts[found].key;
+            n++;
+        }
+    }
+    if (n == 0) {
+        fprintf(stderr, "No accounts selected\n");
+        free(sel);
+        return 0;
+    }
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < cfg->naccounts; j++) {
+            if (cfg->accounts[j].name != sel[i].name) continue;
+            hmac_signer_init(&sel[i].signer, cfg->accounts[j].secret, strlen(cfg->accounts[j].secret));
+            limiter_init(&sel[i].limiter, cfg->rate, cfg->burst);
+        }
+    }
+    *out = sel;
+    *count = n;
+    return 1;
+}
+
+static void free_accounts(struct account_client *accounts, int count) {
+    for (int i = 0; i < count; i++) hmac_signer_clear(&accounts[i].signer);
+    free(accounts);
+}
+
+const char *socket_path(void) {
+    const char *path = getenv("INDODAX_SOCKET");
+    return path ? path : SOCKET_PATH;
+}
+
+int main(int argc, char *argv[]) {
+    struct config cfg;
+
+    // Options may appear anywhere; pull them out so commands only see positionals
+    int timings = 0;
+    int verify = 0;
+    enum output_format output = OUTPUT_TABLE;
+    const char *output_arg = NULL;
+    const char *accounts = NULL;
+    enum metrics_format metrics_format = METRICS_JSON;
+    int nargs = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0) {
+            argv[nargs++] = argv[i];
+        } else if (strcmp(argv[i], "--timings") == 0 || strcmp(argv[i], "--timings=json") == 0) {
+            timings = 1;
+        } else if (strcmp(argv[i], "--timings=prom") == 0) {
+            timings = 1;
+            metrics_format = METRICS_PROMETHEUS;
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verify = 1;
+        } else if (strcmp(argv[i], "--jsonl") == 0) {
+            output_arg = "jsonl";
+        } else if (strncmp(argv[i], "--output=", 9) == 0) {
+            output_arg = argv[i] + 9;
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_arg = argv[++i];
+        } else if (strncmp(argv[i], "--accounts=", 11) == 0) {
+            accounts = argv[i] + 11;
+        } else if (strcmp(argv[i], "--accounts") == 0 && i + 1 < argc) {
+            accounts = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    argc = nargs;
+    argv[argc] = NULL;
+
+    if (output_arg && !output_parse(output_arg, &output)) {
+        fprintf(stderr, "Unknown output format %s (table, jsonl, csv or raw)\n", output_arg);
+        return 1;
+    }
+
+    if (argc < 2) {
+	p_head();
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!command_valid(argc, argv)) {
+        fprintf(stderr, "Invalid or insufficient arguments\n");
+        return 1;
+    }
+
+    if (accounts && (strcmp(argv[1], "serve") == 0 || strcmp(argv[1], "remote") == 0)) {
+        fprintf(stderr, "--accounts is for one-shot commands only\n");
+        return 1;
+    }
+
+    // serve writes its timings to whichever client it is answering
+    if (timings && strcmp(argv[1], "remote") == 0) {
+        fprintf(stderr, "--timings is not forwarded by remote; start serve with --timings instead\n");
+        return 1;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "remote") == 0) {
+        return remote_command(socket_path(), argc - 2, argv + 2, output, verify);
+    }
+
+    // Reads only local files, so it needs neither credentials nor libcurl
+    if (strcmp(argv[1], "history") == 0) {
+        p_head();
+        return run_history(argc >= 3 ? argv[2] : NULL);
+    }
+
+    if (!read_config(CONFIG_PATH, &cfg)) {
+        return 1;
+    }
+    retry_set_policy(&cfg.policy);
+
+    struct account_client *selected = NULL;
+    int nselected = 0;
+    if (accounts && !select_accounts(&cfg, accounts, &selected, &nselected)) {
+        free_config(&cfg);
+        return 1;
+    }
+
+    order_id_init();
+    clock_load_offset(CLOCK_OFFSET_PATH);
+
+    // Derive the HMAC key state once per process instead of once per request
+    struct hmac_signer signer;
+    hmac_signer_init(&signer, cfg.secret, strlen(cfg.secret));
+
+    struct tapi_client client;
+    memset(&client, 0, sizeof(client));
+    client.key = cfg.key;
+    snprintf(client.base_url, sizeof(client.base_url), "%s", cfg.base_url);
+    snprintf(client.tapi_url, sizeof(client.tapi_url), "%s/tapi", cfg.base_url);
+    client.signer = &signer;
+    client.timings = timings;
+    client.cache_ttl = cfg.cache_ttl;
+    client.ticker_ttl = cfg.ticker_ttl;
+    client.pairs_ttl = cfg.pairs_ttl;
+    client.watch_min_ms = cfg.watch_min_ms;
+    client.watch_max_ms = cfg.watch_max_ms;
+    client.out.format = output;
+    client.verify = verify;
+    client.metrics_format = metrics_format;
+    client.accounts = selected;
+    client.naccounts = nselected;
+    limiter_init(&client.limiter, cfg.rate, cfg.burst);
+    if (timings || strcmp(argv[1], "serve") == 0) {
+        client.metrics = metrics_new();
+    }
+
+    // Once, up front; curl_easy_init would otherwise do it implicitly
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    struct conn_settings conn = { cfg.base_url, cfg.dns_ttl, cfg.tls_resume, cfg.ca_file[0] ? cfg.ca_file : NULL };
+    conn_cache_open(CONN_CACHE_PATH, &conn);
+
+    client.curl = curl_easy_init();
+    if (!client.curl) {
+        fprintf(stderr, "curl init failed\n");
+        conn_cache_close();
+        curl_global_cleanup();
+        hmac_signer_clear(&signer);
+        free_accounts(selected, nselected);
+        free_config(&cfg);
+        return 1;
+    }
+    conn_cache_setup(client.curl);
+
+    int rc;
+    if (strcmp(argv[1], "serve") == 0) {
+        rc = serve(argc >= 3 ? argv[2] : socket_path(), &client);
+    } else {
+        rc = run_command(&client, argc, argv);
+    }
+
+    free(client.metrics);
+    pairs_free(&client.pairs);
+    response_free(&client.response);
+    out_free(&client.out);
+    for (int i = 0; i < 2; i++) {
+        if (client.hedge[i]) curl_easy_cleanup(client.hedge[i]);
+        response_free(&client.hedge_response[i]);
+    }
+    if (client.multi) curl_multi_cleanup(client.multi);
+    curl_easy_cleanup(client.curl);
+    conn_cache_close();
+    curl_global_cleanup();
+    hmac_signer_clear(&signer);
+    free_accounts(selected, nselected);
+    free_config(&cfg);
+    return rc;
 }
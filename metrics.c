@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "metrics.h"
+
+static const char *phase_names[PHASE_COUNT] = {
+    "dns", "connect", "tls", "server", "transfer", "total", "sign", "parse"
+};
+
+uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int hist_index(uint64_t value) {
+    if (value < 2 * HIST_SUB_BUCKETS) return (int)value;
+
+    int shift = 63 - __builtin_clzll(value) - 6;     // value >> shift is in [64, 128)
+    if (shift > HIST_SHIFTS) return HIST_BUCKETS - 1;
+    return 2 * HIST_SUB_BUCKETS + (shift - 1) * HIST_SUB_BUCKETS + (int)((value >> shift) - HIST_SUB_BUCKETS);
+}
+
+// Upper edge of a bucket, so reported percentiles never understate latency.
+static uint64_t hist_value(int index) {
+    if (index < 2 * HIST_SUB_BUCKETS) return index;
+
+    int shift = (index - 2 * HIST_SUB_BUCKETS) / HIST_SUB_BUCKETS + 1;
+    uint64_t sub = (index - 2 * HIST_SUB_BUCKETS) % HIST_SUB_BUCKETS + HIST_SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+void hist_record(struct latency_hist *h, uint64_t value) {
+    h->counts[hist_index(value)]++;
+    if (h->count == 0 || value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+    h->count++;
+    h->sum += value;
+}
+
+uint64_t hist_percentile(const struct latency_hist *h, double pct) {
+    if (h->count == 0) return 0;
+
+    uint64_t rank = (uint64_t)(pct / 100.0 * h->count + 0.5);
+    if (rank < 1) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t v = hist_value(i);
+            return v > h->max ? h->max : v;
+        }
+    }
+    return h->max;
+}
+
+static uint64_t curl_time_us(CURL *curl, CURLINFO info) {
+    curl_off_t v = 0;
+    if (curl_easy_getinfo(curl, info, &v) != CURLE_OK || v < 0) return 0;
+    return (uint64_t)v;
+}
+
+static uint64_t span(uint64_t from, uint64_t to) {
+    return to > from ? to - from : 0;
+}
+
+// libcurl reports cumulative times from the start of the transfer; turn them
+// into per-phase durations. Reused connections report 0 for DNS/connect/TLS.
+void timings_from_curl(CURL *curl, struct request_timings *t) {
+    uint64_t dns = curl_time_us(curl, CURLINFO_NAMELOOKUP_TIME_T);
+    uint64_t connect = curl_time_us(curl, CURLINFO_CONNECT_TIME_T);
+    uint64_t appconnect = curl_time_us(curl, CURLINFO_APPCONNECT_TIME_T);
+    uint64_t pretransfer = curl_time_us(curl, CURLINFO_PRETRANSFER_TIME_T);
+    uint64_t starttransfer = curl_time_us(curl, CURLINFO_STARTTRANSFER_TIME_T);
+    uint64_t total = curl_time_us(curl, CURLINFO_TOTAL_TIME_T);
+
+    t->phase_us[PHASE_DNS] = dns;
+    t->phase_us[PHASE_CONNECT] = span(dns, connect);
+    t->phase_us[PHASE_TLS] = appconnect ? span(connect, appconnect) : 0;
+    t->phase_us[PHASE_SERVER] = span(pretransfer, starttransfer);
+    t->phase_us[PHASE_TRANSFER] = span(starttransfer, total);
+    t->phase_us[PHASE_TOTAL] = total;
+}
+
+void timings_print_json(FILE *out, const char *postdata, const struct request_timings *t) {
+    const char *method = strstr(postdata, "method=");
+    int len = 0;
+    if (method) {
+        method += 7;
+        len = (int)strcspn(method, "&");
+    }
+
+    fprintf(out, "{\"method\":\"%.*s\"", len, method ? method : "");
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        fprintf(out, ",\"%s_us\":%llu", phase_names[i], (unsigned long long)t->phase_us[i]);
+    }
+    fprintf(out, "}\n");
+}
+
+struct metrics *metrics_new(void) {
+    return calloc(1, sizeof(struct metrics));
+}
+
+void metrics_record(struct metrics *m, const struct request_timings *t, int ok) {
+    m->requests++;
+    if (!ok) m->errors++;
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        hist_record(&m->hist[i], t->phase_us[i]);
+    }
+}
+
+static void dump_json(FILE *out, const struct metrics *m) {
+    fprintf(out, "{\"requests\":%llu,\"errors\":%llu,\"phases\":{",
+            (unsigned long long)m->requests, (unsigned long long)m->errors);
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const struct latency_hist *h = &m->hist[i];
+        fprintf(out, "%s\"%s\":{\"count\":%llu,\"min_us\":%llu,\"mean_us\":%llu,\"p50_us\":%llu,"
+                     "\"p99_us\":%llu,\"p999_us\":%llu,\"max_us\":%llu}",
+                i ? "," : "", phase_names[i],
+                (unsigned long long)h->count,
+                (unsigned long long)h->min,
+                (unsigned long long)(h->count ? h->sum / h->count : 0),
+                (unsigned long long)hist_percentile(h, 50.0),
+                (unsigned long long)hist_percentile(h, 99.0),
+                (unsigned long long)hist_percentile(h, 99.9),
+                (unsigned long long)h->max);
+    }
+    fprintf(out, "}}\n");
+}
+
+static void dump_prometheus(FILE *out, const struct metrics *m) {
+    static const double quantiles[] = { 0.5, 0.99, 0.999 };
+
+    fprintf(out, "# TYPE indodax_requests_total counter\n");
+    fprintf(out, "indodax_requests_total %llu\n", (unsigned long long)m->requests);
+    fprintf(out, "# TYPE indodax_request_errors_total counter\n");
+    fprintf(out, "indodax_request_errors_total %llu\n", (unsigned long long)m->errors);
+    fprintf(out, "# TYPE indodax_phase_seconds summary\n");
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const struct latency_hist *h = &m->hist[i];
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+            fprintf(out, "indodax_phase_seconds{phase=\"%s\",quantile=\"%g\"} %.6f\n",
+                    phase_names[i], quantiles[q], hist_percentile(h, quantiles[q] * 100.0) / 1e6);
+        }
+        fprintf(out, "indodax_phase_seconds_sum{phase=\"%s\"} %.6f\n", phase_names[i], h->sum / 1e6);
+        fprintf(out, "indodax_phase_seconds_count{phase=\"%s\"} %llu\n", phase_names[i], (unsigned long long)h->count);
+    }
+}
+
+void metrics_dump(FILE *out, const struct metrics *m, enum metrics_format format) {
+    if (format == METRICS_PROMETHEUS) {
+        dump_prometheus(out, m);
+    } else {
+        dump_json(out, m);
+    }
+}
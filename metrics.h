@@ -0,0 +1,61 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <curl/curl.h>
+
+// Log-linear buckets in microseconds: exact below 128us, then 64 buckets per
+// power of two (under 1.6% error) up to ~2^40us.
+#define HIST_SUB_BUCKETS 64
+#define HIST_SHIFTS 34
+#define HIST_BUCKETS (2 * HIST_SUB_BUCKETS + HIST_SHIFTS * HIST_SUB_BUCKETS)
+
+enum metric_phase {
+    PHASE_DNS,
+    PHASE_CONNECT,
+    PHASE_TLS,
+    PHASE_SERVER,
+    PHASE_TRANSFER,
+    PHASE_TOTAL,
+    PHASE_SIGN,
+    PHASE_PARSE,
+    PHASE_COUNT
+};
+
+enum metrics_format {
+    METRICS_JSON,
+    METRICS_PROMETHEUS
+};
+
+struct latency_hist {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+};
+
+struct request_timings {
+    uint64_t phase_us[PHASE_COUNT];
+};
+
+struct metrics {
+    struct latency_hist hist[PHASE_COUNT];
+    uint64_t requests;
+    uint64_t errors;
+};
+
+uint64_t monotonic_us(void);
+
+void hist_record(struct latency_hist *h, uint64_t value);
+uint64_t hist_percentile(const struct latency_hist *h, double pct);
+
+void timings_from_curl(CURL *curl, struct request_timings *t);
+void timings_print_json(FILE *out, const char *postdata, const struct request_timings *t);
+
+struct metrics *metrics_new(void);
+void metrics_record(struct metrics *m, const struct request_timings *t, int ok);
+void metrics_dump(FILE *out, const struct metrics *m, enum metrics_format format);
+
+#endif
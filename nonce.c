@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/random.h>
+#include "nonce.h"
+
+static _Atomic int64_t offset_ms = 0;
+static _Atomic int64_t last_nonce = 0;
+static _Atomic uint32_t sequence = 0;
+static uint32_t instance_id = 0;
+
+int64_t wall_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000 + atomic_load_explicit(&offset_ms, memory_order_relaxed);
+}
+
+int64_t nonce_ms(void) {
+    int64_t now = wall_ms();
+    int64_t last = atomic_load_explicit(&last_nonce, memory_order_relaxed);
+    int64_t next;
+
+    do {
+        next = now > last ? now : last + 1;
+    } while (!atomic_compare_exchange_weak_explicit(&last_nonce, &last, next,
+                                                    memory_order_relaxed, memory_order_relaxed));
+    return next;
+}
+
+void clock_set_offset(int64_t ms) {
+    atomic_store(&offset_ms, ms);
+}
+
+int64_t clock_get_offset(void) {
+    return atomic_load(&offset_ms);
+}
+
+int clock_load_offset(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    long long ms;
+    int ok = fscanf(f, "%lld", &ms) == 1;
+    fclose(f);
+    if (ok) clock_set_offset(ms);
+    return ok;
+}
+
+int clock_save_offset(const char *path, int64_t ms) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror("Error writing clock offset");
+        return 0;
+    }
+    fprintf(f, "%lld\n", (long long)ms);
+    fclose(f);
+    return 1;
+}
+
+// 36^4 possible instances
+#define INSTANCE_SPACE 1679616u
+
+static const char base36_digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+// Writes v in base 36, zero-padded to at least width digits; returns the length.
+static int base36(char *out, uint64_t v, int width) {
+    char tmp[16];
+    int n = 0;
+    do {
+        tmp[n++] = base36_digits[v % 36];
+        v /= 36;
+    } while (v);
+    while (n < width) tmp[n++] = '0';
+    for (int i = 0; i < n; i++) out[i] = tmp[n - 1 - i];
+    out[n] = '\0';
+    return n;
+}
+
+void order_id_init(void) {
+    uint32_t r;
+    if (getrandom(&r, sizeof(r), GRND_NONBLOCK) != sizeof(r)) {
+        r = (uint32_t)getpid() * 2654435761u ^ (uint32_t)wall_ms();
+    }
+    instance_id = r % INSTANCE_SPACE;
+}
+
+// Base 36 keeps the id short enough for the tables: "dogeidr-mf3k2x1b-0k9z3-idX".
+void order_id_next(char *buf, size_t size, const char *coin) {
+    uint32_t seq = atomic_fetch_add_explicit(&sequence, 1, memory_order_relaxed);
+    char ms[16], inst[8], counter[8];
+
+    base36(ms, (uint64_t)wall_ms(), 8);
+    base36(inst, instance_id, 4);
+    base36(counter, seq, 1);
+    snprintf(buf, size, "%sidr-%s-%s%s-idX", coin, ms, inst, counter);
+}
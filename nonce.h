@@ -0,0 +1,29 @@
+#ifndef NONCE_H
+#define NONCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CLOCK_OFFSET_PATH "indodax_clock.offset"
+
+// Wall clock in milliseconds, corrected by the offset measured against the
+// exchange's server_time (0 until calibrated).
+int64_t wall_ms(void);
+
+// Like wall_ms() but strictly increasing across all threads of the process, so
+// two requests never carry the same timestamp.
+int64_t nonce_ms(void);
+
+void clock_set_offset(int64_t offset_ms);
+int64_t clock_get_offset(void);
+int clock_load_offset(const char *path);
+int clock_save_offset(const char *path, int64_t offset_ms);
+
+// client_order_id = <coin>idr-<ms>-<instance><sequence>-idX, all in base 36. The
+// instance part is random per process and the sequence is a per-process atomic
+// counter, so ids are unique across threads and concurrently running processes
+// without locks.
+void order_id_init(void);
+void order_id_next(char *buf, size_t size, const char *coin);
+
+#endif
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "order_cache.h"
+
+#define INITIAL_CAPACITY 256
+
+static uint32_t fnv1a(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static size_t file_size(uint32_t capacity) {
+    return sizeof(struct order_cache_header) + (size_t)capacity * sizeof(struct cached_order);
+}
+
+static int map_file(struct order_cache *cache, size_t size) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, cache->fd, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap order cache");
+        return 0;
+    }
+    cache->map_size = size;
+    cache->hdr = p;
+    cache->slots = (struct cached_order *)(cache->hdr + 1);
+    return 1;
+}
+
+static int init_file(struct order_cache *cache, uint32_t capacity) {
+    size_t size = file_size(capacity);
+    if (ftruncate(cache->fd, 0) != 0 || ftruncate(cache->fd, size) != 0) {
+        perror("resize order cache");
+        return 0;
+    }
+    if (!map_file(cache, size)) return 0;
+
+    cache->hdr->magic = ORDER_CACHE_MAGIC;
+    cache->hdr->version = ORDER_CACHE_VERSION;
+    cache->hdr->capacity = capacity;
+    return 1;
+}
+
+int order_cache_open(struct order_cache *cache, const char *path) {
+    memset(cache, 0, sizeof(*cache));
+    cache->fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (cache->fd < 0) {
+        perror("Error opening order cache");
+        return 0;
+    }
+    if (flock(cache->fd, LOCK_EX) != 0) {
+        perror("lock order cache");
+        close(cache->fd);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(cache->fd, &st) != 0) {
+        close(cache->fd);
+        return 0;
+    }
+
+    // A missing, truncated or foreign file is simply rebuilt empty
+    if ((size_t)st.st_size >= sizeof(struct order_cache_header) && map_file(cache, st.st_size)) {
+        const struct order_cache_header *h = cache->hdr;
+        if (h->magic == ORDER_CACHE_MAGIC && h->version == ORDER_CACHE_VERSION &&
+            h->capacity && (h->capacity & (h->capacity - 1)) == 0 &&
+            file_size(h->capacity) == (size_t)st.st_size) {
+            return 1;
+        }
+        munmap(cache->hdr, cache->map_size);
+    }
+
+    if (!init_file(cache, INITIAL_CAPACITY)) {
+        close(cache->fd);
+        return 0;
+    }
+    return 1;
+}
+
+void order_cache_close(struct order_cache *cache) {
+    if (cache->hdr) {
+        msync(cache->hdr, cache->map_size, MS_ASYNC);
+        munmap(cache->hdr, cache->map_size);
+    }
+    if (cache->fd >= 0) close(cache->fd);   // also drops the flock
+    cache->hdr = NULL;
+    cache->fd = -1;
+}
+
+// Returns the slot holding id, or the first reusable slot on its probe chain.
+static struct cached_order *probe(const struct order_cache *cache, const char *id, uint32_t hash, int *found) {
+    uint32_t mask = cache->hdr->capacity - 1;
+    struct cached_order *reuse = NULL;
+
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        struct cached_order *slot = &cache->slots[i];
+        if (slot->state == SLOT_EMPTY) {
+            *found = 0;
+            return reuse ? reuse : slot;
+        }
+        if (slot->state == SLOT_DELETED) {
+            if (!reuse) reuse = slot;
+        } else if (slot->hash == hash && strcmp(slot->client_order_id, id) == 0) {
+            *found = 1;
+            return slot;
+        }
+    }
+}
+
+static int grow(struct order_cache *cache) {
+    uint32_t old_capacity = cache->hdr->capacity;
+    int64_t synced_at = cache->hdr->synced_at;
+    size_t live = cache->hdr->count;
+    uint32_t capacity = old_capacity;
+    while (live * 2 >= capacity) capacity *= 2;
+
+    struct cached_order *saved = malloc(live * sizeof(*saved) + 1);
+    if (!saved) return 0;
+    size_t n = 0;
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (cache->slots[i].state == SLOT_USED) saved[n++] = cache->slots[i];
+    }
+
+    munmap(cache->hdr, cache->map_size);
+    if (!init_file(cache, capacity)) {
+        free(saved);
+        return 0;
+    }
+    cache->hdr->synced_at = synced_at;
+
+    for (size_t i = 0; i < n; i++) {
+        int found;
+        struct cached_order *slot = probe(cache, saved[i].client_order_id, saved[i].hash, &found);
+        *slot = saved[i];
+        cache->hdr->count++;
+    }
+    free(saved);
+    return 1;
+}
+
+int order_cache_put(struct order_cache *cache, const char *client_order_id, const char *pair,
+                    const char *type, const char *price, const char *remain) {
+    // A truncated key would never match the lookups and removals that follow
+    if (!client_order_id || !*client_order_id ||
+        strlen(client_order_id) >= sizeof(cache->slots[0].client_order_id)) {
+        return 0;
+    }
+
+    // Keep at least a quarter of the table empty so probe chains stay short
+    if ((cache->hdr->count + cache->hdr->deleted + 1) * 4 > cache->hdr->capacity * 3 && !grow(cache)) {
+        return 0;
+    }
+
+    uint32_t hash = fnv1a(client_order_id);
+    int found;
+    struct cached_order *slot = probe(cache, client_order_id, hash, &found);
+    if (!found) {
+        if (slot->state == SLOT_DELETED) cache->hdr->deleted--;
+        cache->hdr->count++;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    snprintf(slot->client_order_id, sizeof(slot->client_order_id), "%s", client_order_id);
+    snprintf(slot->pair, sizeof(slot->pair), "%s", pair ? pair : "");
+    snprintf(slot->type, sizeof(slot->type), "%s", type ? type : "");
+    snprintf(slot->price, sizeof(slot->price), "%s", price ? price : "");
+    snprintf(slot->remain, sizeof(slot->remain), "%s", remain ? remain : "");
+    slot->hash = hash;
+    slot->state = SLOT_USED;
+    return 1;
+}
+
+int order_cache_remove(struct order_cache *cache, const char *client_order_id) {
+    int found;
+    struct cached_order *slot = probe(cache, client_order_id, fnv1a(client_order_id), &found);
+    if (!found) return 0;
+
+    slot->state = SLOT_DELETED;
+    cache->hdr->count--;
+    cache->hdr->deleted++;
+    return 1;
+}
+
+const struct cached_order *order_cache_get(const struct order_cache *cache, const char *client_order_id) {
+    int found;
+    struct cached_order *slot = probe(cache, client_order_id, fnv1a(client_order_id), &found);
+    return found ? slot : NULL;
+}
+
+// Drops every order, or only those for pair, ahead of a resync.
+void order_cache_clear(struct order_cache *cache, const char *pair) {
+    if (!pair) {
+        memset(cache->slots, 0, (size_t)cache->hdr->capacity * sizeof(struct cached_order));
+        cache->hdr->count = 0;
+        cache->hdr->deleted = 0;
+        return;
+    }
+
+    for (uint32_t i = 0; i < cache->hdr->capacity; i++) {
+        struct cached_order *slot = &cache->slots[i];
+        if (slot->state == SLOT_USED && strcmp(slot->pair, pair) == 0) {
+            slot->state = SLOT_DELETED;
+            cache->hdr->count--;
+            cache->hdr->deleted++;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef ORDER_CACHE_H
+#define ORDER_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define ORDER_CACHE_MAGIC 0x4f445849u   // "IXDO"
+#define ORDER_CACHE_VERSION 2
+
+enum slot_state {
+    SLOT_EMPTY,
+    SLOT_USED,
+    SLOT_DELETED
+};
+
+struct cached_order {
+    char client_order_id[128];     // same width as trade_row and cancel_row
+    char pair[24];
+    char type[8];
+    char price[24];
+    char remain[32];
+    uint32_t state;
+    uint32_t hash;
+};
+
+struct order_cache_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;      // always a power of two
+    uint32_t count;         // SLOT_USED entries
+    uint32_t deleted;       // SLOT_DELETED entries still occupying probe chains
+    uint32_t reserved;
+    int64_t synced_at;      // time of the last full openOrders sync, 0 if never
+};
+
+// Open orders keyed by client_order_id in an open-addressed hash table that
+// lives in a memory-mapped file. The file is flock()ed while open, so one
+// process updates it at a time.
+struct order_cache {
+    int fd;
+    size_t map_size;
+    struct order_cache_header *hdr;
+    struct cached_order *slots;
+};
+
+int order_cache_open(struct order_cache *cache, const char *path);
+void order_cache_close(struct order_cache *cache);
+
+int order_cache_put(struct order_cache *cache, const char *client_order_id, const char *pair,
+                    const char *type, const char *price, const char *remain);
+int order_cache_remove(struct order_cache *cache, const char *client_order_id);
+const struct cached_order *order_cache_get(const struct order_cache *cache, const char *client_order_id);
+void order_cache_clear(struct order_cache *cache, const char *pair);
+
+static inline int order_cache_fresh(const struct order_cache *cache, int ttl) {
+    return ttl > 0 && cache->hdr->synced_at > 0 && time(NULL) - cache->hdr->synced_at < ttl;
+}
+
+#endif
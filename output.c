@@ -0,0 +1,204 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "output.h"
+
+#define OUT_MIN_CAPACITY 4096
+
+static const char *names[] = { "table", "jsonl", "csv", "raw" };
+
+int output_parse(const char *name, enum output_format *format) {
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *format = (enum output_format)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char *output_name(enum output_format format) {
+    return names[format];
+}
+
+static int reserve(struct out_buf *b, size_t extra) {
+    if (b->len + extra <= b->cap) return 1;
+    if (b->failed) return 0;
+
+    size_t cap = b->cap ? b->cap : OUT_MIN_CAPACITY;
+    while (cap < b->len + extra) cap *= 2;
+    char *tmp = realloc(b->data, cap);
+    if (!tmp) {
+        b->failed = 1;
+        return 0;
+    }
+    b->data = tmp;
+    b->cap = cap;
+    return 1;
+}
+
+void out_mem(struct out_buf *b, const char *s, size_t n) {
+    if (!reserve(b, n)) return;
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+void out_str(struct out_buf *b, const char *s) {
+    out_mem(b, s, strlen(s));
+}
+
+// Formats straight into the buffer; only a row longer than the space left
+// costs a second pass.
+void out_printf(struct out_buf *b, const char *fmt, ...) {
+    if (!reserve(b, 256)) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n >= b->cap - b->len) {
+        if (!reserve(b, (size_t)n + 1)) return;
+        va_start(ap, fmt);
+        vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+    }
+    b->len += n;
+}
+
+static int absent(const char *value) {
+    return !value || strcmp(value, "N/A") == 0;
+}
+
+static void json_string(struct out_buf *b, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    out_mem(b, "\"", 1);
+    const char *run = s;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out_mem(b, run, s - run);
+        char esc[6] = { '\\', (char)c, 0, 0, 0, 0 };
+        size_t n = 2;
+        if (c == '\n') esc[1] = 'n';
+        else if (c == '\t') esc[1] = 't';
+        else if (c == '\r') esc[1] = 'r';
+        else if (c < 0x20) {
+            memcpy(esc + 1, "u00", 3);
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 15];
+            n = 6;
+        }
+        out_mem(b, esc, n);
+        run = s + 1;
+    }
+    out_mem(b, run, s - run);
+    out_mem(b, "\"", 1);
+}
+
+// Quoted only when it has to be, with inner quotes doubled
+static void csv_cell(struct out_buf *b, const char *s) {
+    if (!s[strcspn(s, ",\"\r\n")]) {
+        out_str(b, s);
+        return;
+    }
+    out_mem(b, "\"", 1);
+    for (const char *q; (q = strchr(s, '"')); s = q + 1) {
+        out_mem(b, s, q - s + 1);
+        out_mem(b, "\"", 1);
+    }
+    out_str(b, s);
+    out_mem(b, "\"", 1);
+}
+
+static void json_members(struct out_buf *b, const char *const *fields, const char *const *values, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (i) out_mem(b, ",", 1);
+        json_string(b, fields[i]);
+        out_mem(b, ":", 1);
+        if (absent(values[i])) out_mem(b, "null", 4);
+        else json_string(b, values[i]);
+    }
+}
+
+void out_header(struct output *out, const char *const *fields, size_t n) {
+    if (out->format != OUTPUT_CSV) return;
+    for (size_t i = 0; i < n; i++) {
+        if (i) out_mem(&out->buf, ",", 1);
+        out_str(&out->buf, fields[i]);
+    }
+    out_mem(&out->buf, "\n", 1);
+}
+
+void out_record(struct output *out, const char *const *fields, const char *const *values, size_t n) {
+    struct out_buf *b = &out->buf;
+    if (out->format == OUTPUT_CSV) {
+        for (size_t i = 0; i < n; i++) {
+            if (i) out_mem(b, ",", 1);
+            if (!absent(values[i])) csv_cell(b, values[i]);
+        }
+        out_mem(b, "\n", 1);
+        return;
+    }
+
+    out_mem(b, "{", 1);
+    json_members(b, fields, values, n);
+    out_mem(b, "}\n", 2);
+}
+
+// A JSONL event: a numeric ts (ms since the epoch) ahead of the string fields.
+void out_event(struct output *out, long long ts, const char *const *fields, const char *const *values, size_t n) {
+    struct out_buf *b = &out->buf;
+    out_printf(b, "{\"ts\":%lld", ts);
+    if (n) out_mem(b, ",", 1);
+    json_members(b, fields, values, n);
+    out_mem(b, "}\n", 2);
+}
+
+int out_write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// Writes what has been built up (after anything still in stdio's buffer, so
+// the two never interleave) and empties the buffer for the next command.
+int out_flush(struct output *out) {
+    struct out_buf *b = &out->buf;
+    int ok = !b->failed;
+    if (b->failed) fprintf(stderr, "Memory allocation error\n");
+
+    fflush(stdout);
+    if (ok && b->len && !out_write_all(STDOUT_FILENO, b->data, b->len)) {
+        perror("Error writing output");
+        ok = 0;
+    }
+    b->len = 0;
+    b->failed = 0;
+    return ok;
+}
+
+// libcurl write callback for raw output: each chunk goes from libcurl's
+// receive buffer to stdout without being copied.
+size_t out_stream_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    struct output *out = userp;
+    size_t realsize = size * nmemb;
+    if (out->streamed == 0) fflush(stdout);
+    if (!out_write_all(STDOUT_FILENO, contents, realsize)) return 0;
+    out->streamed += realsize;
+    return realsize;
+}
+
+void out_free(struct output *out) {
+    free(out->buf.data);
+    memset(&out->buf, 0, sizeof(out->buf));
+}
@@ -0,0 +1,49 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+
+enum output_format {
+    OUTPUT_TABLE,       // fixed-width tables for people, the default
+    OUTPUT_JSONL,       // one JSON object per row
+    OUTPUT_CSV,         // a header line, then one row per line
+    OUTPUT_RAW          // the exchange's response body as it arrived
+};
+
+// A command's stdout, built in memory and handed to the kernel with one
+// write(2). The buffer keeps its capacity, so serve stops allocating once it
+// has produced its largest result.
+struct out_buf {
+    char *data;
+    size_t len;
+    size_t cap;
+    int failed;         // an append did not fit in memory; nothing is written
+};
+
+struct output {
+    enum output_format format;
+    struct out_buf buf;
+    int stream;         // raw: the next /tapi body goes straight to stdout
+    size_t streamed;    // bytes of that body already written
+};
+
+int output_parse(const char *name, enum output_format *format);
+const char *output_name(enum output_format format);
+
+void out_mem(struct out_buf *b, const char *s, size_t n);
+void out_str(struct out_buf *b, const char *s);
+void out_printf(struct out_buf *b, const char *fmt, ...);
+
+// Rows for the machine formats: JSONL objects or CSV lines, fields in the
+// order given. A value of "N/A" (an absent field, see jv_copy) becomes null
+// or an empty cell. out_header writes the CSV header and nothing otherwise.
+void out_header(struct output *out, const char *const *fields, size_t n);
+void out_record(struct output *out, const char *const *fields, const char *const *values, size_t n);
+void out_event(struct output *out, long long ts, const char *const *fields, const char *const *values, size_t n);
+
+int out_write_all(int fd, const char *data, size_t len);
+int out_flush(struct output *out);
+size_t out_stream_callback(void *contents, size_t size, size_t nmemb, void *userp);
+void out_free(struct output *out);
+
+#endif
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tapi_json.h"
+#include "snapshot.h"
+#include "pairs.h"
+
+static int view_int(const struct json_view *v, int fallback) {
+    char buf[16];
+    if (v->kind != JV_STRING && v->kind != JV_NUMBER) return fallback;
+    return atoi(jv_copy(v->text, buf, sizeof(buf)));
+}
+
+static int cmp_asset(const void *a, const void *b) {
+    return strcmp(((const struct pair_info *)a)->asset, ((const struct pair_info *)b)->asset);
+}
+
+// Reads the /api/pairs array ({"ticker_id":"btc_idr","price_round":8,
+// "trade_min_base_currency":10000,...}) and joins in the tick size from
+// /api/price_increments ({"increments":{"btc_idr":"1000",...}}). Pairs quoted
+// in anything but IDR are skipped.
+int pairs_parse(struct pair_table *t, const char *pairs, size_t pairs_len,
+                const char *increments, size_t increments_len, char *err, size_t errsize) {
+    struct json_view root, entry, value;
+    size_t offset;
+    memset(t, 0, sizeof(*t));
+
+    if (!jv_parse(pairs, pairs_len, &root, &offset) || root.kind != JV_ARRAY) {
+        snprintf(err, errsize, "JSON error: invalid pairs list near offset %zu", offset);
+        return 0;
+    }
+
+    size_t cap = 0;
+    struct json_iter it;
+    jv_iter_init(&it, &root);
+    while (jv_array_next(&it, &entry) > 0) {
+        struct json_view id;
+        if (entry.kind != JV_OBJECT || !jv_object_get(&entry, "ticker_id", &id) || id.kind != JV_STRING ||
+            id.text.len <= 4 || id.text.len - 4 >= sizeof(t->items[0].asset) ||
+            memcmp(id.text.ptr + id.text.len - 4, "_idr", 4) != 0) {
+            continue;
+        }
+        if (t->count == cap) {
+            cap = cap ? cap * 2 : 256;
+            struct pair_info *tmp = realloc(t->items, cap * sizeof(*tmp));
+            if (!tmp) {
+                snprintf(err, errsize, "Memory allocation error");
+                pairs_free(t);
+                return 0;
+            }
+            t->items = tmp;
+        }
+
+        struct pair_info *p = &t->items[t->count++];
+        memset(p, 0, sizeof(*p));
+        memcpy(p->asset, id.text.ptr, id.text.len - 4);
+        p->amount_decimals = DEC_DECIMALS;
+
+        struct json_iter fields;
+        struct strview key;
+        jv_iter_init(&fields, &entry);
+        while (jv_object_next(&fields, &key, &value) > 0) {
+            if (sv_eq(key, "price_round")) p->amount_decimals = view_int(&value, DEC_DECIMALS);
+            else if (sv_eq(key, "trade_min_base_currency")) p->min_idr = jv_dec(&value);
+            else if (sv_eq(key, "trade_min_traded_currency")) p->min_coin = jv_dec(&value);
+            else if (sv_eq(key, "is_maintenance")) p->maintenance = view_int(&value, 0) != 0;
+        }
+        if (p->amount_decimals < 0 || p->amount_decimals > DEC_DECIMALS) p->amount_decimals = DEC_DECIMALS;
+    }
+    qsort(t->items, t->count, sizeof(*t->items), cmp_asset);
+
+    struct json_view incs;
+    if (!jv_parse(increments, increments_len, &root, &offset) || root.kind != JV_OBJECT ||
+        !jv_object_get(&root, "increments", &incs) || incs.kind != JV_OBJECT) {
+        snprintf(err, errsize, "Missing 'increments' object");
+        pairs_free(t);
+        return 0;
+    }
+
+    struct strview pair;
+    jv_iter_init(&it, &incs);
+    while (jv_object_next(&it, &pair, &value) > 0) {
+        char asset[sizeof(t->items[0].asset)];
+        if (pair.len <= 4 || pair.len - 4 >= sizeof(asset) || memcmp(pair.ptr + pair.len - 4, "_idr", 4) != 0) {
+            continue;
+        }
+        memcpy(asset, pair.ptr, pair.len - 4);
+        asset[pair.len - 4] = '\0';
+        struct pair_info *p = (struct pair_info *)pairs_find(t, asset);
+        if (p) p->tick = jv_dec(&value);
+    }
+
+    t->fetched_at = time(NULL);
+    return 1;
+}
+
+// The cached rules if they are younger than ttl seconds.
+int pairs_load(struct pair_table *t, const char *path, int ttl) {
+    void *items;
+    memset(t, 0, sizeof(*t));
+    if (!snapshot_load(path, PAIRS_MAGIC, PAIRS_VERSION, ttl, sizeof(*t->items), &items, &t->count, &t->fetched_at)) {
+        return 0;
+    }
+    t->items = items;
+    return 1;
+}
+
+int pairs_save(const struct pair_table *t, const char *path) {
+    return snapshot_save(path, PAIRS_MAGIC, PAIRS_VERSION, t->items, sizeof(*t->items), t->count, t->fetched_at,
+                         "pairs cache");
+}
+
+void pairs_free(struct pair_table *t) {
+    free(t->items);
+    memset(t, 0, sizeof(*t));
+}
+
+const struct pair_info *pairs_find(const struct pair_table *t, const char *asset) {
+    struct pair_info key;
+    if (!t->count || strlen(asset) >= sizeof(key.asset)) return NULL;
+    snprintf(key.asset, sizeof(key.asset), "%s", asset);
+    return bsearch(&key, t->items, t->count, sizeof(*t->items), cmp_asset);
+}
+
+// Nearest valid price at or below (or, with up, at or above) price.
+dec64 pair_snap_price(const struct pair_info *p, dec64 price, int up) {
+    if (p->tick <= 0 || price <= 0) return price;
+    dec64 off = price % p->tick;
+    if (off == 0) return price;
+    return up ? price - off + p->tick : price - off;
+}
+
+// Brings an order within the pair's rules before it is signed. The price snaps
+// to a tick away from the market (down for buys, up for sells) and the amount
+// (IDR for buys, coin for sells) is truncated to the decimals the exchange
+// takes; returns 0 with a reason when the result is still not a valid order.
+int pair_normalize(const struct pair_info *p, int buy, dec64 *price, dec64 *amount, char *err, size_t errsize) {
+    char a[DEC_STRLEN];
+    if (p->maintenance) {
+        snprintf(err, errsize, "%s_idr is under maintenance", p->asset);
+        return 0;
+    }
+    if (*price <= 0 || *amount <= 0) {
+        snprintf(err, errsize, "Price and amount must be positive");
+        return 0;
+    }
+
+    *price = pair_snap_price(p, *price, !buy);
+    if (*price <= 0) {
+        snprintf(err, errsize, "Price is below one tick (%s)", dec_format(p->tick, a, sizeof(a)));
+        return 0;
+    }
+
+    int decimals = buy ? 0 : p->amount_decimals;
+    dec64 unit = 1;
+    for (int i = decimals; i < DEC_DECIMALS; i++) unit *= 10;
+    *amount -= *amount % unit;
+
+    dec64 value = buy ? *amount : dec_mul(*amount, *price);
+    if (!buy && p->min_coin > 0 && *amount < p->min_coin) {
+        snprintf(err, errsize, "Below minimum %s %s", dec_format(p->min_coin, a, sizeof(a)), p->asset);
+        return 0;
+    }
+    if (p->min_idr > 0 && value < p->min_idr) {
+        snprintf(err, errsize, "Below minimum order %s IDR", dec_format(p->min_idr, a, sizeof(a)));
+        return 0;
+    }
+    if (*amount <= 0) {
+        snprintf(err, errsize, "Amount rounds to zero");
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,39 @@
+#ifndef PAIRS_H
+#define PAIRS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "decimal.h"
+
+#define PAIRS_MAGIC 0x50584449u        // "IDXP"
+#define PAIRS_VERSION 3
+
+// Trading rules for one <asset>_idr pair, from /api/pairs and
+// /api/price_increments. A zero limit is one the exchange did not state.
+struct pair_info {
+    char asset[16];
+    dec64 tick;                 // price increment in IDR
+    dec64 min_idr;              // smallest order value in IDR
+    dec64 min_coin;             // smallest order amount in the asset
+    int32_t amount_decimals;    // decimals accepted in a coin amount
+    int32_t maintenance;        // trading suspended
+};
+
+// Sorted by asset for bsearch; the cache file is a header and the items as is.
+struct pair_table {
+    struct pair_info *items;
+    size_t count;
+    int64_t fetched_at;
+};
+
+int pairs_parse(struct pair_table *t, const char *pairs, size_t pairs_len,
+                const char *increments, size_t increments_len, char *err, size_t errsize);
+int pairs_load(struct pair_table *t, const char *path, int ttl);
+int pairs_save(const struct pair_table *t, const char *path);
+void pairs_free(struct pair_table *t);
+const struct pair_info *pairs_find(const struct pair_table *t, const char *asset);
+
+dec64 pair_snap_price(const struct pair_info *p, dec64 price, int up);
+int pair_normalize(const struct pair_info *p, int buy, dec64 *price, dec64 *amount, char *err, size_t errsize);
+
+#endif
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "response.h"
+
+void response_reset(struct MemoryStruct *mem, CURL *curl) {
+    mem->size = 0;
+    mem->curl = curl;
+    if (mem->memory) mem->memory[0] = '\0';
+}
+
+void response_free(struct MemoryStruct *mem) {
+    free(mem->memory);
+    mem->memory = NULL;
+    mem->size = 0;
+    mem->capacity = 0;
+}
+
+int response_reserve(struct MemoryStruct *mem, size_t need) {
+    if (need <= mem->capacity) return 1;
+
+    size_t capacity = mem->capacity ? mem->capacity : RESPONSE_MIN_CAPACITY;
+    while (capacity < need) capacity *= 2;
+
+    char *ptr = realloc(mem->memory, capacity);
+    if (!ptr) {
+        fprintf(stderr, "Memory allocation error\n");
+        return 0;
+    }
+    mem->memory = ptr;
+    mem->capacity = capacity;
+    return 1;
+}
+
+size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    struct MemoryStruct *mem = (struct MemoryStruct *)userp;
+
+    // First chunk of a body: headers are in, so reserve the whole thing at once
+    if (mem->size == 0 && mem->curl) {
+        curl_off_t length = -1;
+        if (curl_easy_getinfo(mem->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length) == CURLE_OK &&
+            length > 0 && length < RESPONSE_MAX_PRESIZE) {
+            response_reserve(mem, (size_t)length + 1);
+        }
+    }
+
+    if (!response_reserve(mem, mem->size + realsize + 1)) {
+        return 0;
+    }
+
+    memcpy(&(mem->memory[mem->size]), contents, realsize);
+    mem->size += realsize;
+    mem->memory[mem->size] = 0;
+
+    return realsize;
+}
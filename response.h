@@ -0,0 +1,24 @@
+#ifndef RESPONSE_H
+#define RESPONSE_H
+
+#include <stddef.h>
+#include <curl/curl.h>
+
+#define RESPONSE_MIN_CAPACITY 4096
+#define RESPONSE_MAX_PRESIZE (64 * 1024 * 1024)
+
+// Response body buffer. It grows geometrically and keeps its capacity across
+// requests, so a warm client stops allocating once it has seen its largest reply.
+struct MemoryStruct {
+    char *memory;
+    size_t size;
+    size_t capacity;
+    CURL *curl;         // when set, used to size the buffer from Content-Length
+};
+
+void response_reset(struct MemoryStruct *mem, CURL *curl);
+void response_free(struct MemoryStruct *mem);
+int response_reserve(struct MemoryStruct *mem, size_t need);
+size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp);
+
+#endif
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+#include "metrics.h"
+#include "nonce.h"
+#include "tapi_json.h"
+#include "retry.h"
+
+static struct call_policy policy;
+static struct latency_hist read_hist;      // successful reads, for the hedge delay
+
+void retry_set_policy(const struct call_policy *p) {
+    policy = *p;
+}
+
+const struct call_policy *retry_policy(void) {
+    return &policy;
+}
+
+// Timeouts for one attempt of a call in class cls.
+void retry_apply(CURL *easy, enum method_class cls) {
+    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS, policy.connect_ms);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, policy.timeout_ms[cls]);
+}
+
+// Failures another attempt might not hit. Anything else (bad URL, TLS
+// verification, ...) fails the same way every time.
+int retry_transient(CURLcode res) {
+    switch (res) {
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_PARTIAL_FILE:
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_HTTP2:
+    case CURLE_HTTP2_STREAM:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// Failures before a single byte of the request left, so even a trade can
+// simply be sent again.
+int retry_unsent(CURLcode res) {
+    return res == CURLE_COULDNT_RESOLVE_HOST || res == CURLE_COULDNT_CONNECT || res == CURLE_SSL_CONNECT_ERROR;
+}
+
+// For a trade or cancelByClientOrderId, the getOrderByClientOrderId call that
+// tells whether it took effect. Returns 0 for anything without an
+// idempotency key.
+int retry_lookup_postdata(const char *postdata, char *out, size_t size) {
+    const char *method = strstr(postdata, "method=");
+    if (!method || (strncmp(method + 7, "trade&", 6) != 0 && strncmp(method + 7, "cancelByClientOrderId&", 22) != 0)) {
+        return 0;
+    }
+
+    const char *id = strstr(postdata, "&client_order_id=");
+    if (!id) return 0;
+    id += 17;
+    int len = (int)strcspn(id, "&");
+    if (len == 0) return 0;
+
+    long epoch_ms = (long)nonce_ms();
+    snprintf(out, size, "method=getOrderByClientOrderId&timestamp=%ld&recvWindow=%ld&client_order_id=%.*s",
+             epoch_ms, epoch_ms + 49900000, len, id);
+    return 1;
+}
+
+// A trade landed when the exchange knows the order at all. A cancel is done
+// once the order is anything but open; an open or unknown order gets the
+// cancel again so the caller sees the exchange's own answer. Any other error
+// (rate limit, maintenance, credentials) says nothing about the order.
+enum lookup_outcome retry_lookup_outcome(enum method_class cls, const char *json, size_t len) {
+    struct json_view root, success, code, ret, order, status;
+    size_t offset;
+    if (!json || !jv_parse(json, len, &root, &offset) || root.kind != JV_OBJECT ||
+        !jv_object_get(&root, "success", &success)) {
+        return LOOKUP_UNKNOWN;
+    }
+    if (success.text.len == 1 && success.text.ptr[0] == '0') {
+        if (jv_object_get(&root, "error_code", &code) && code.kind == JV_STRING && sv_eq(code.text, "order_not_found")) {
+            return LOOKUP_RESEND;
+        }
+        return LOOKUP_UNKNOWN;
+    }
+    if (!jv_object_get(&root, "return", &ret) || !jv_object_get(&ret, "order", &order) || order.kind != JV_OBJECT) {
+        return LOOKUP_UNKNOWN;
+    }
+    if (cls != CLASS_CANCEL) return LOOKUP_LANDED;
+    if (jv_object_get(&order, "status", &status) && status.kind == JV_STRING && sv_eq(status.text, "open")) {
+        return LOOKUP_RESEND;
+    }
+    return LOOKUP_LANDED;
+}
+
+void retry_note_read(uint64_t total_us) {
+    if (total_us) hist_record(&read_hist, total_us);
+}
+
+// p95 of the reads seen so far, or hedge_ms until there are enough of them.
+uint64_t retry_hedge_delay_us(void) {
+    if (read_hist.count < HEDGE_MIN_SAMPLES) return (uint64_t)policy.hedge_ms * 1000;
+    return hist_percentile(&read_hist, 95.0);
+}
@@ -0,0 +1,44 @@
+#ifndef RETRY_H
+#define RETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <curl/curl.h>
+#include "sched.h"
+
+#define CONNECT_TIMEOUT_MS 3000
+#define HEDGE_MS 250
+#define HEDGE_MIN_SAMPLES 20
+
+// Per-class limits for every /tapi call: how long one attempt may take and
+// how many more attempts a transient failure gets.
+struct call_policy {
+    long connect_ms;
+    long timeout_ms[CLASS_COUNT];       // whole transfer, 0 for none
+    int retries[CLASS_COUNT];
+    int hedge;                          // race a second copy of slow reads
+    long hedge_ms;                      // hedge delay until enough reads give a p95
+};
+
+// What getOrderByClientOrderId says about an order whose trade or cancel
+// failed in flight.
+enum lookup_outcome {
+    LOOKUP_LANDED,          // the trade was placed, or the order is no longer open
+    LOOKUP_RESEND,          // the request never took effect, safe to send again
+    LOOKUP_UNKNOWN          // no clear answer; do not risk a duplicate
+};
+
+// Process-wide, like the connection cache: set once from the config
+void retry_set_policy(const struct call_policy *p);
+const struct call_policy *retry_policy(void);
+void retry_apply(CURL *easy, enum method_class cls);
+
+int retry_transient(CURLcode res);
+int retry_unsent(CURLcode res);
+int retry_lookup_postdata(const char *postdata, char *out, size_t size);
+enum lookup_outcome retry_lookup_outcome(enum method_class cls, const char *json, size_t len);
+
+void retry_note_read(uint64_t total_us);
+uint64_t retry_hedge_delay_us(void);
+
+#endif
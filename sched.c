@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sched.h"
+#include "conn_cache.h"
+#include "retry.h"
+
+#define MAX_HEADER 256
+
+static const char *class_names[CLASS_COUNT] = { "cancel", "trade", "read" };
+
+const char *method_class_name(enum method_class cls) {
+    return class_names[cls];
+}
+
+enum method_class method_class(const char *postdata) {
+    const char *method = strstr(postdata, "method=");
+    if (!method) return CLASS_READ;
+    method += 7;
+    if (strncmp(method, "cancel", 6) == 0) return CLASS_CANCEL;
+    if (strncmp(method, "trade", 5) == 0 && (method[5] == '&' || method[5] == '\0')) return CLASS_TRADE;
+    return CLASS_READ;
+}
+
+void limiter_init(struct rate_limiter *rl, const double rate[CLASS_COUNT], const double burst[CLASS_COUNT]) {
+    uint64_t now = monotonic_us();
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        struct token_bucket *b = &rl->bucket[i];
+        b->rate = rate[i];
+        b->burst = burst[i] >= 1 ? burst[i] : 1;
+        b->tokens = b->burst;
+        b->last_us = now;
+    }
+}
+
+// Returns 0 when a token was taken, otherwise the microseconds until one is due.
+uint64_t bucket_take(struct token_bucket *b, uint64_t now_us) {
+    if (b->rate <= 0) return 0;
+
+    if (now_us > b->last_us) {
+        b->tokens += (now_us - b->last_us) * b->rate / 1e6;
+        if (b->tokens > b->burst) b->tokens = b->burst;
+        b->last_us = now_us;
+    }
+    if (b->tokens >= 1) {
+        b->tokens -= 1;
+        return 0;
+    }
+    return (uint64_t)((1 - b->tokens) * 1e6 / b->rate) + 1;
+}
+
+void limiter_wait(struct rate_limiter *rl, enum method_class cls) {
+    uint64_t wait;
+    while ((wait = bucket_take(&rl->bucket[cls], monotonic_us())) != 0) {
+        struct timespec ts = { (time_t)(wait / 1000000), (long)(wait % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+// The request parameters minus the ones that change on every call, so two
+// getInfo calls built a millisecond apart compare equal.
+static void build_coalesce_key(const char *postdata, char *out, size_t size) {
+    size_t n = 0;
+    const char *p = postdata;
+    out[0] = '\0';
+    while (*p) {
+        size_t len = strcspn(p, "&");
+        if (strncmp(p, "nonce=", 6) != 0 && strncmp(p, "timestamp=", 10) != 0 &&
+            strncmp(p, "recvWindow=", 11) != 0 && n + len + 1 < size) {
+            memcpy(out + n, p, len);
+            n += len;
+            out[n++] = '&';
+            out[n] = '\0';
+        }
+        p += len;
+        if (*p == '&') p++;
+    }
+}
+
+static struct tapi_job *find_leader(struct tapi_job *list, const struct tapi_job *job) {
+    for (; list; list = list->next) {
+        if (list->key == job->key && strcmp(list->coalesce_key, job->coalesce_key) == 0) return list;
+    }
+    return NULL;
+}
+
+void sched_init(struct scheduler *s, CURLM *multi, const char *url, const char *key,
+                const struct hmac_signer *signer, struct rate_limiter *limiter, int max_inflight) {
+    memset(s, 0, sizeof(*s));
+    s->multi = multi;
+    s->url = url;
+    s->key = key;
+    s->signer = signer;
+    s->limiter = limiter;
+    s->max_inflight = max_inflight < 1 ? 1 : max_inflight;
+}
+
+static void enqueue(struct scheduler *s, struct tapi_job *job) {
+    job->next = NULL;
+    if (s->tail[job->cls]) s->tail[job->cls]->next = job;
+    else s->head[job->cls] = job;
+    s->tail[job->cls] = job;
+}
+
+void sched_submit(struct scheduler *s, struct tapi_job *job) {
+    if (!job->key) job->key = s->key;
+    if (!job->signer) job->signer = s->signer;
+    if (!job->limiter) job->limiter = s->limiter;
+    job->cls = job->url ? CLASS_READ : method_class(job->postdata);
+    job->result = CURLE_OK;
+    job->leader = NULL;
+    job->followers = NULL;
+    job->next = NULL;
+    job->coalesce_key[0] = '\0';
+    job->attempts = 0;
+    job->lookups = 0;
+    job->landed = 0;
+    job->looking_up = 0;
+
+    if (job->cls == CLASS_READ && !job->url) {
+        build_coalesce_key(job->postdata, job->coalesce_key, sizeof(job->coalesce_key));
+        struct tapi_job *leader = find_leader(s->head[CLASS_READ], job);
+        if (!leader) leader = find_leader(s->active, job);
+        if (leader) {
+            job->leader = leader;
+            job->next = leader->followers;
+            leader->followers = job;
+            return;
+        }
+    }
+    enqueue(s, job);
+}
+
+// Share one HTTP/2 connection when the server offers it instead of opening
+// more. Only TLS negotiates h2 up front; over cleartext PIPEWAIT would hold
+// every transfer until the first response proves the server is HTTP/1.
+static void share_connection(CURL *easy, const char *url) {
+    curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    if (strncmp(url, "https://", 8) == 0) curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+}
+
+static int start_job(struct scheduler *s, struct tapi_job *job) {
+    CURL *easy = curl_easy_init();
+    if (!easy) return 0;
+    conn_cache_setup(easy);
+    retry_apply(easy, job->cls);
+
+    if (job->url) {
+        response_reset(&job->response, easy);
+        curl_easy_setopt(easy, CURLOPT_URL, job->url);
+        curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, (void *)&job->response);
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, job);
+        share_connection(easy, job->url);
+        curl_multi_add_handle(s->multi, easy);
+        return 1;
+    }
+
+    char signature[SIGN_HEX_LEN + 1];
+    uint64_t t0 = monotonic_us();
+    hmac_signer_sign(job->signer, job->postdata, strlen(job->postdata), signature);
+    job->timings.phase_us[PHASE_SIGN] = monotonic_us() - t0;
+
+    char key_hdr[MAX_HEADER], sign_hdr[MAX_HEADER];
+    snprintf(key_hdr, sizeof(key_hdr), "Key: %s", job->key);
+    snprintf(sign_hdr, sizeof(sign_hdr), "Sign: %s", signature);
+    job->headers = curl_slist_append(NULL, "Content-Type: application/x-www-form-urlencoded");
+    job->headers = curl_slist_append(job->headers, key_hdr);
+    job->headers = curl_slist_append(job->headers, sign_hdr);
+
+    response_reset(&job->response, easy);
+
+    curl_easy_setopt(easy, CURLOPT_URL, s->url);
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDS, job->postdata);
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, job->headers);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, (void *)&job->response);
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, job);
+    share_connection(easy, s->url);
+    curl_multi_add_handle(s->multi, easy);
+
+    if (job->cls == CLASS_READ) {
+        job->next = s->active;
+        s->active = job;
+    }
+    return 1;
+}
+
+static void unlink_active(struct scheduler *s, struct tapi_job *job) {
+    if (job->cls != CLASS_READ) return;
+    for (struct tapi_job **p = &s->active; *p; p = &(*p)->next) {
+        if (*p == job) {
+            *p = job->next;
+            break;
+        }
+    }
+}
+
+static void end_lookup(struct tapi_job *job) {
+    memcpy(job->postdata, job->resend, sizeof(job->postdata));
+    job->cls = job->resend_cls;
+    job->looking_up = 0;
+}
+
+// Decides whether a finished attempt goes back on the queue. Reads are simply
+// sent again. A trade or cancel that failed after it may have left is first
+// looked up by client_order_id (as a read, under the read token bucket) and
+// only re-sent when the exchange shows it did not take effect.
+static int retry_job(struct scheduler *s, struct tapi_job *job) {
+    const struct call_policy *p = retry_policy();
+
+    if (job->looking_up) {
+        if (job->result != CURLE_OK && retry_transient(job->result) && job->lookups < p->retries[CLASS_READ]) {
+            job->lookups++;
+        } else {
+            enum lookup_outcome o = job->result == CURLE_OK ?
+                retry_lookup_outcome(job->resend_cls, job->response.memory, job->response.size) : LOOKUP_UNKNOWN;
+            unlink_active(s, job);
+            end_lookup(job);
+            if (o == LOOKUP_LANDED) {
+                job->landed = 1;
+                return 0;
+            }
+            if (o == LOOKUP_UNKNOWN) {
+                job->result = job->failure;
+                return 0;
+            }
+        }
+        unlink_active(s, job);
+        enqueue(s, job);
+        return 1;
+    }
+
+    if (!retry_transient(job->result) || job->attempts >= p->retries[job->cls]) return 0;
+    unlink_active(s, job);
+    if (job->cls != CLASS_READ && !job->url && !retry_unsent(job->result)) {
+        char lookup[SCHED_PAYLOAD];
+        if (!retry_lookup_postdata(job->postdata, lookup, sizeof(lookup))) return 0;
+        memcpy(job->resend, job->postdata, sizeof(job->resend));
+        snprintf(job->postdata, sizeof(job->postdata), "%s", lookup);
+        job->resend_cls = job->cls;
+        job->failure = job->result;
+        job->cls = CLASS_READ;
+        job->looking_up = 1;
+        job->lookups = 0;
+    }
+    job->attempts++;
+    enqueue(s, job);
+    return 1;
+}
+
+// Hands the leader's result to it and every coalesced follower.
+static void finish_job(struct scheduler *s, struct tapi_job *job) {
+    unlink_active(s, job);
+    job->next = NULL;
+
+    struct tapi_job *f = job->followers;
+    job->followers = NULL;
+    if (s->done) s->done(job, s->ctx);
+
+    while (f) {
+        struct tapi_job *next = f->next;
+        f->next = NULL;
+        f->result = job->result;
+        f->timings = job->timings;
+        response_reset(&f->response, NULL);
+        if (job->response.memory && response_reserve(&f->response, job->response.size + 1)) {
+            memcpy(f->response.memory, job->response.memory, job->response.size + 1);
+            f->response.size = job->response.size;
+        }
+        if (s->done) s->done(f, s->ctx);
+        f = next;
+    }
+}
+
+// Unlinks the first job in class c whose bucket has a token. Jobs of an
+// account that is out of tokens keep their order but do not hold up other
+// accounts queued behind them; public GETs never wait.
+static struct tapi_job *take_ready(struct scheduler *s, int c, uint64_t now, uint64_t *wait_us) {
+    struct rate_limiter *blocked = NULL;
+    for (struct tapi_job **p = &s->head[c], *prev = NULL; *p; prev = *p, p = &(*p)->next) {
+        struct tapi_job *job = *p;
+        struct rate_limiter *rl = job->url ? NULL : job->limiter;
+        if (rl && rl == blocked) continue;
+
+        uint64_t w = rl ? bucket_take(&rl->bucket[c], now) : 0;
+        if (w) {
+            if (!*wait_us || w < *wait_us) *wait_us = w;
+            blocked = rl;
+            continue;
+        }
+        *p = job->next;
+        if (s->tail[c] == job) s->tail[c] = prev;
+        job->next = NULL;
+        return job;
+    }
+    return NULL;
+}
+
+// Drains every queued job. Slots go to the highest-priority class whose
+// bucket has a token; when all are empty the loop sleeps in curl_multi_poll
+// until the earliest refill or a transfer completes.
+void sched_run(struct scheduler *s, job_done_fn done, void *ctx) {
+    s->done = done;
+    s->ctx = ctx;
+
+    for (;;) {
+        uint64_t now = monotonic_us();
+        uint64_t wait_us = 0;
+        int queued = 0;
+
+        for (int c = 0; c < CLASS_COUNT; c++) {
+            struct tapi_job *job;
+            while (s->inflight < s->max_inflight && (job = take_ready(s, c, now, &wait_us))) {
+                if (start_job(s, job)) {
+                    s->inflight++;
+                } else {
+                    job->result = CURLE_FAILED_INIT;
+                    finish_job(s, job);
+                }
+            }
+            if (s->head[c]) queued = 1;
+        }
+
+        if (!queued && s->inflight == 0) break;
+
+        if (s->inflight == 0) {
+            struct timespec ts = { (time_t)(wait_us / 1000000), (long)(wait_us % 1000000) * 1000 };
+            nanosleep(&ts, NULL);
+            continue;
+        }
+
+        int running = 0;
+        curl_multi_perform(s->multi, &running);
+
+        CURLMsg *msg;
+        int pending;
+        while ((msg = curl_multi_info_read(s->multi, &pending))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            CURL *easy = msg->easy_handle;
+            struct tapi_job *job = NULL;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **)&job);
+            job->result = msg->data.result;
+            timings_from_curl(easy, &job->timings);
+            conn_cache_note(easy, job->result);
+            curl_multi_remove_handle(s->multi, easy);
+            curl_easy_cleanup(easy);
+            job->response.curl = NULL;
+            curl_slist_free_all(job->headers);
+            job->headers = NULL;
+            s->inflight--;
+            if (!retry_job(s, job)) finish_job(s, job);
+        }
+
+        if (s->inflight > 0) {
+            int timeout_ms = 1000;
+            if (queued && wait_us && wait_us / 1000 + 1 < (uint64_t)timeout_ms) timeout_ms = (int)(wait_us / 1000) + 1;
+            curl_multi_poll(s->multi, NULL, 0, timeout_ms, NULL);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include <curl/curl.h>
+#include "sign.h"
+#include "metrics.h"
+#include "response.h"
+
+#define SCHED_PAYLOAD 512
+
+// Method classes in priority order: a queued cancel always goes out before a
+// queued trade, and both before reads.
+enum method_class {
+    CLASS_CANCEL,
+    CLASS_TRADE,
+    CLASS_READ,
+    CLASS_COUNT
+};
+
+// Token bucket refilled continuously at rate tokens/s up to burst.
+// A rate <= 0 disables limiting for the class.
+struct token_bucket {
+    double rate;
+    double burst;
+    double tokens;
+    uint64_t last_us;
+};
+
+struct rate_limiter {
+    struct token_bucket bucket[CLASS_COUNT];
+};
+
+enum method_class method_class(const char *postdata);
+const char *method_class_name(enum method_class cls);
+
+void limiter_init(struct rate_limiter *rl, const double rate[CLASS_COUNT], const double burst[CLASS_COUNT]);
+uint64_t bucket_take(struct token_bucket *b, uint64_t now_us);
+void limiter_wait(struct rate_limiter *rl, enum method_class cls);
+
+// One signed /tapi call. Read jobs with the same key and parameters as one
+// already queued or in flight are coalesced: they never hit the wire and get
+// a copy of the leader's response instead. A job with url set is instead an
+// unsigned GET of a public endpoint; it queues as a read but takes no token.
+// Transient failures are retried under the call policy (retry.h); a trade or
+// cancel that may have reached the exchange is first looked up by its
+// client_order_id, and landed is set when that settles it.
+struct tapi_job {
+    char postdata[SCHED_PAYLOAD];
+    const char *url;
+    const char *key;                    // defaults to the scheduler's key
+    const struct hmac_signer *signer;
+    struct rate_limiter *limiter;       // defaults to the scheduler's; per account when fanning out
+    enum method_class cls;
+    struct curl_slist *headers;
+    struct MemoryStruct response;
+    CURLcode result;
+    struct request_timings timings;
+    char coalesce_key[SCHED_PAYLOAD];
+    struct tapi_job *leader;            // set on a coalesced follower
+    struct tapi_job *followers;
+    struct tapi_job *next;
+    void *user;
+    int attempts;                       // retries used so far
+    int lookups;                        // retries of the current lookup, under the read budget
+    int landed;                         // response is the getOrderByClientOrderId reply
+    int looking_up;                     // postdata is that lookup; the original waits in resend
+    enum method_class resend_cls;
+    CURLcode failure;                   // what sent the job to the lookup
+    char resend[SCHED_PAYLOAD];
+};
+
+typedef void (*job_done_fn)(struct tapi_job *job, void *ctx);
+
+struct scheduler {
+    CURLM *multi;
+    const char *url;
+    const char *key;
+    const struct hmac_signer *signer;
+    struct rate_limiter *limiter;
+    int max_inflight;
+    int inflight;
+    struct tapi_job *head[CLASS_COUNT];
+    struct tapi_job *tail[CLASS_COUNT];
+    struct tapi_job *active;            // in-flight read leaders, for coalescing
+    job_done_fn done;
+    void *ctx;
+};
+
+void sched_init(struct scheduler *s, CURLM *multi, const char *url, const char *key,
+                const struct hmac_signer *signer, struct rate_limiter *limiter, int max_inflight);
+void sched_submit(struct scheduler *s, struct tapi_job *job);
+void sched_run(struct scheduler *s, job_done_fn done, void *ctx);
+
+#endif
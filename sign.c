@@ -0,0 +1,60 @@
+// The low-level SHA512 API is deprecated in OpenSSL 3 but it is the only one
+// whose context can be copied by value, which is the whole point here.
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <string.h>
+#include <openssl/crypto.h>
+#include "sign.h"
+
+#define SHA512_BLOCK 128
+
+static const char hex_digits[] = "0123456789abcdef";
+
+void hex_encode(const unsigned char *in, size_t len, char *out) {
+    for (size_t i = 0; i < len; i++) {
+        out[i * 2] = hex_digits[in[i] >> 4];
+        out[i * 2 + 1] = hex_digits[in[i] & 0x0f];
+    }
+    out[len * 2] = '\0';
+}
+
+void hmac_signer_init(struct hmac_signer *signer, const char *key, size_t key_len) {
+    unsigned char block[SHA512_BLOCK] = {0};
+    unsigned char pad[SHA512_BLOCK];
+
+    // Keys longer than one block are replaced by their digest (RFC 2104)
+    if (key_len > SHA512_BLOCK) {
+        SHA512((const unsigned char *)key, key_len, block);
+    } else {
+        memcpy(block, key, key_len);
+    }
+
+    for (int i = 0; i < SHA512_BLOCK; i++) pad[i] = block[i] ^ 0x36;
+    SHA512_Init(&signer->inner);
+    SHA512_Update(&signer->inner, pad, sizeof(pad));
+
+    for (int i = 0; i < SHA512_BLOCK; i++) pad[i] = block[i] ^ 0x5c;
+    SHA512_Init(&signer->outer);
+    SHA512_Update(&signer->outer, pad, sizeof(pad));
+
+    OPENSSL_cleanse(block, sizeof(block));
+    OPENSSL_cleanse(pad, sizeof(pad));
+}
+
+// out_hex must hold SIGN_HEX_LEN + 1 bytes.
+void hmac_signer_sign(const struct hmac_signer *signer, const char *data, size_t len, char *out_hex) {
+    unsigned char digest[SHA512_DIGEST_LENGTH];
+    SHA512_CTX ctx = signer->inner;
+
+    SHA512_Update(&ctx, data, len);
+    SHA512_Final(digest, &ctx);
+
+    ctx = signer->outer;
+    SHA512_Update(&ctx, digest, sizeof(digest));
+    SHA512_Final(digest, &ctx);
+
+    hex_encode(digest, sizeof(digest), out_hex);
+}
+
+void hmac_signer_clear(struct hmac_signer *signer) {
+    OPENSSL_cleanse(signer, sizeof(*signer));
+}
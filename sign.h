@@ -0,0 +1,22 @@
+#ifndef SIGN_H
+#define SIGN_H
+
+#include <stddef.h>
+#include <openssl/sha.h>
+
+#define SIGN_HEX_LEN 128
+
+// HMAC-SHA512 with the key pads hashed once up front. Signing a payload copies
+// the saved inner/outer states instead of re-deriving them from the secret.
+// A signer is read-only after init, so threads can share one.
+struct hmac_signer {
+    SHA512_CTX inner;
+    SHA512_CTX outer;
+};
+
+void hmac_signer_init(struct hmac_signer *signer, const char *key, size_t key_len);
+void hmac_signer_sign(const struct hmac_signer *signer, const char *data, size_t len, char *out_hex);
+void hmac_signer_clear(struct hmac_signer *signer);
+void hex_encode(const unsigned char *in, size_t len, char *out);
+
+#endif
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "snapshot.h"
+
+// Loads the items if the snapshot is younger than ttl seconds. Returns 0 for
+// a missing, stale or foreign file without complaint; *items is then NULL.
+int snapshot_load(const char *path, uint32_t magic, uint32_t version, int ttl,
+                  size_t item_size, void **items, size_t *count, int64_t *fetched_at) {
+    struct snapshot_header h;
+    *items = NULL;
+    *count = 0;
+    if (ttl <= 0) return 0;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+
+    int ok = fread(&h, sizeof(h), 1, f) == 1 && h.magic == magic && h.version == version &&
+             time(NULL) - h.fetched_at < ttl && h.fetched_at <= time(NULL);
+    if (ok && h.count > 0) {
+        *items = malloc((size_t)h.count * item_size);
+        ok = *items && fread(*items, item_size, h.count, f) == h.count;
+    }
+    fclose(f);
+
+    if (!ok) {
+        free(*items);
+        *items = NULL;
+        return 0;
+    }
+    *count = h.count;
+    *fetched_at = h.fetched_at;
+    return 1;
+}
+
+// Written to a temporary file and renamed over the old one, so a concurrent
+// reader sees either snapshot whole. what names the cache in error messages.
+int snapshot_save(const char *path, uint32_t magic, uint32_t version, const void *items,
+                  size_t item_size, size_t count, int64_t fetched_at, const char *what) {
+    char tmp[512], msg[64];
+    snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long)getpid());
+    snprintf(msg, sizeof(msg), "Error writing %s", what);
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        perror(msg);
+        return 0;
+    }
+    struct snapshot_header h = { magic, version, (uint32_t)count, 0, fetched_at };
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(items, item_size, count, f) == count;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp, path) != 0) {
+        perror(msg);
+        unlink(tmp);
+        return 0;
+    }
+    return 1;
+}
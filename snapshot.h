@@ -0,0 +1,22 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cache file for one snapshot of a public endpoint: this header, then count
+// fixed-size items exactly as they sit in memory.
+struct snapshot_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+    int64_t fetched_at;
+};
+
+int snapshot_load(const char *path, uint32_t magic, uint32_t version, int ttl,
+                  size_t item_size, void **items, size_t *count, int64_t *fetched_at);
+int snapshot_save(const char *path, uint32_t magic, uint32_t version, const void *items,
+                  size_t item_size, size_t count, int64_t fetched_at, const char *what);
+
+#endif
@@ -0,0 +1,466 @@
+#include <stdio.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "tapi_json.h"
+
+static const char *skip_ws(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+    return p;
+}
+
+// Next '"' or '\\' at or after p, or end.
+static const char *scan_string(const char *p, const char *end) {
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *)p);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(b, quote), _mm_cmpeq_epi8(b, backslash)));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\') p++;
+    return p;
+}
+
+// p points at the opening quote; returns the closing quote or NULL.
+static const char *end_of_string(const char *p, const char *end) {
+    p++;
+    for (;;) {
+        p = scan_string(p, end);
+        if (p >= end) return NULL;
+        if (*p == '"') return p;
+        p += 2;
+    }
+}
+
+struct scan_state {
+    int depth;
+    int in_string;
+    int escaped;
+};
+
+// One byte of the container walk; returns 1 when the outermost close is seen.
+static int scan_byte(struct scan_state *st, char c) {
+    if (st->in_string) {
+        if (st->escaped) st->escaped = 0;
+        else if (c == '\\') st->escaped = 1;
+        else if (c == '"') st->in_string = 0;
+        return 0;
+    }
+    if (c == '"') {
+        st->in_string = 1;
+    } else if ((c | 0x20) == '{') {
+        st->depth++;
+    } else if ((c | 0x20) == '}') {
+        return --st->depth == 0;
+    }
+    return 0;
+}
+
+#ifdef __SSE2__
+// Bit i set when an odd number of bits at or below i are set in x
+static inline unsigned prefix_xor16(unsigned x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    return x & 0xFFFF;
+}
+#endif
+
+// p points at '{' or '['; returns one past the matching close or NULL.
+// Sixteen bytes at a time: quote bits give a prefix-xor mask of string
+// interiors, and only brackets outside it touch the depth. Blocks holding
+// a backslash fall back to the byte loop, which tracks escapes.
+static const char *end_of_container(const char *p, const char *end) {
+    struct scan_state st = { 0, 0, 0 };
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    const __m128i bit5 = _mm_set1_epi8(0x20);
+    while (end - p >= 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *)p);
+        if (st.escaped || _mm_movemask_epi8(_mm_cmpeq_epi8(b, backslash))) {
+            for (int i = 0; i < 16; i++) {
+                if (scan_byte(&st, p[i])) return p + i + 1;
+            }
+            p += 16;
+            continue;
+        }
+        __m128i folded = _mm_or_si128(b, bit5);
+        unsigned q = _mm_movemask_epi8(_mm_cmpeq_epi8(b, quote));
+        unsigned inside = prefix_xor16(q) ^ (st.in_string ? 0xFFFF : 0);
+        unsigned o = _mm_movemask_epi8(_mm_cmpeq_epi8(folded, open)) & ~inside;
+        unsigned c = _mm_movemask_epi8(_mm_cmpeq_epi8(folded, close)) & ~inside;
+        for (unsigned m = o | c; m; m &= m - 1) {
+            int i = __builtin_ctz(m);
+            if (o & (1u << i)) {
+                st.depth++;
+            } else if (--st.depth == 0) {
+                return p + i + 1;
+            }
+        }
+        st.in_string ^= __builtin_popcount(q) & 1;
+        p += 16;
+    }
+#endif
+    for (; p < end; p++) {
+        if (scan_byte(&st, *p)) return p + 1;
+    }
+    return NULL;
+}
+
+static const char *parse_value(const char *p, const char *end, struct json_view *v) {
+    p = skip_ws(p, end);
+    if (p >= end) return NULL;
+
+    const char *q;
+    switch (*p) {
+    case '"':
+        q = end_of_string(p, end);
+        if (!q) return NULL;
+        v->kind = JV_STRING;
+        v->text.ptr = p + 1;
+        v->text.len = q - p - 1;
+        return q + 1;
+    case '{':
+    case '[':
+        q = end_of_container(p, end);
+        if (!q) return NULL;
+        v->kind = *p == '{' ? JV_OBJECT : JV_ARRAY;
+        v->text.ptr = p;
+        v->text.len = q - p;
+        return q;
+    case 't':
+        if (end - p < 4 || memcmp(p, "true", 4) != 0) return NULL;
+        v->kind = JV_TRUE;
+        q = p + 4;
+        break;
+    case 'f':
+        if (end - p < 5 || memcmp(p, "false", 5) != 0) return NULL;
+        v->kind = JV_FALSE;
+        q = p + 5;
+        break;
+    case 'n':
+        if (end - p < 4 || memcmp(p, "null", 4) != 0) return NULL;
+        v->kind = JV_NULL;
+        q = p + 4;
+        break;
+    default:
+        if (*p != '-' && (*p < '0' || *p > '9')) return NULL;
+        q = p + 1;
+        while (q < end && ((*q >= '0' && *q <= '9') || *q == '.' || *q == 'e' || *q == 'E' || *q == '+' || *q == '-')) q++;
+        v->kind = JV_NUMBER;
+        break;
+    }
+    v->text.ptr = p;
+    v->text.len = q - p;
+    return q;
+}
+
+// Parses the top-level value. A top-level container is taken to end at the
+// last non-blank byte, checked only for the right closing bracket, so the
+// reply is never scanned end to end before the fields are read.
+int jv_parse(const char *buf, size_t len, struct json_view *root, size_t *error_offset) {
+    const char *end = buf + len;
+    const char *p = skip_ws(buf, end);
+    if (p < end && (*p == '{' || *p == '[')) {
+        const char *last = end - 1;
+        while (last > p && (*last == ' ' || *last == '\n' || *last == '\r' || *last == '\t' || *last == '\0')) last--;
+        if (last > p && *last == (*p == '{' ? '}' : ']')) {
+            root->kind = *p == '{' ? JV_OBJECT : JV_ARRAY;
+            root->text.ptr = p;
+            root->text.len = last - p + 1;
+            return 1;
+        }
+    } else if (parse_value(p, end, root)) {
+        return 1;
+    }
+    if (error_offset) *error_offset = p - buf;
+    return 0;
+}
+
+void jv_iter_init(struct json_iter *it, const struct json_view *container) {
+    it->p = container->text.ptr + 1;
+    it->end = container->text.ptr + container->text.len - 1;
+}
+
+// Returns 1 with the next member, 0 at the end of the object, -1 on bad input.
+int jv_object_next(struct json_iter *it, struct strview *key, struct json_view *value) {
+    const char *p = skip_ws(it->p, it->end);
+    if (p < it->end && *p == ',') p = skip_ws(p + 1, it->end);
+    if (p >= it->end) return 0;
+    if (*p != '"') return -1;
+
+    const char *q = end_of_string(p, it->end);
+    if (!q) return -1;
+    key->ptr = p + 1;
+    key->len = q - p - 1;
+
+    p = skip_ws(q + 1, it->end);
+    if (p >= it->end || *p != ':') return -1;
+    p = parse_value(p + 1, it->end, value);
+    if (!p) return -1;
+    it->p = p;
+    return 1;
+}
+
+int jv_array_next(struct json_iter *it, struct json_view *value) {
+    const char *p = skip_ws(it->p, it->end);
+    if (p < it->end && *p == ',') p++;
+    p = skip_ws(p, it->end);
+    if (p >= it->end) return 0;
+    p = parse_value(p, it->end, value);
+    if (!p) return -1;
+    it->p = p;
+    return 1;
+}
+
+int sv_eq(struct strview v, const char *s) {
+    size_t n = strlen(s);
+    return v.ptr && v.len == n && memcmp(v.ptr, s, n) == 0;
+}
+
+int jv_object_get(const struct json_view *obj, const char *key, struct json_view *out) {
+    if (obj->kind != JV_OBJECT) return 0;
+    struct json_iter it;
+    struct strview k;
+    jv_iter_init(&it, obj);
+    while (jv_object_next(&it, &k, out) > 0) {
+        if (sv_eq(k, key)) return 1;
+    }
+    return 0;
+}
+
+// NUL-terminated copy of a view with the common escapes decoded; "N/A" for
+// an absent field. \u escapes outside ASCII become '?'.
+char *jv_copy(struct strview v, char *buf, size_t size) {
+    if (!v.ptr) {
+        snprintf(buf, size, "N/A");
+        return buf;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < v.len && n + 1 < size; i++) {
+        char c = v.ptr[i];
+        if (c == '\\' && i + 1 < v.len) {
+            c = v.ptr[++i];
+            switch (c) {
+            case 'n': c = '\n'; break;
+            case 't': c = '\t'; break;
+            case 'r': c = '\r'; break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'u':
+                if (i + 4 < v.len && v.ptr[i + 1] == '0' && v.ptr[i + 2] == '0' && v.ptr[i + 3] < '8') {
+                    unsigned x = 0;
+                    sscanf(v.ptr + i + 3, "%2x", &x);
+                    c = (char)x;
+                } else {
+                    c = '?';
+                }
+                i += 4;
+                break;
+            }
+        }
+        buf[n++] = c;
+    }
+    if (size) buf[n] = '\0';
+    return buf;
+}
+
+// Checks the {"success":1,"return":{...}} envelope shared by every /tapi
+// method, in one pass over the top-level members. On failure err holds the
+// same message the jansson path used to print.
+int tapi_check_response(const char *buf, size_t len, struct json_view *ret, char *err, size_t errsize) {
+    struct json_view root;
+    size_t offset = 0;
+    if (!jv_parse(buf, len, &root, &offset) || root.kind != JV_OBJECT) {
+        snprintf(err, errsize, "JSON error: invalid JSON near offset %zu", offset);
+        return 0;
+    }
+
+    struct json_view success = { JV_NONE, { NULL, 0 } };
+    struct json_view error = { JV_NONE, { NULL, 0 } };
+    struct json_iter it;
+    struct strview key;
+    struct json_view value;
+    int rc;
+    ret->kind = JV_NONE;
+
+    jv_iter_init(&it, &root);
+    while ((rc = jv_object_next(&it, &key, &value)) > 0) {
+        if (sv_eq(key, "success")) success = value;
+        else if (sv_eq(key, "return")) *ret = value;
+        else if (sv_eq(key, "error")) error = value;
+    }
+    if (rc < 0) {
+        snprintf(err, errsize, "JSON error: invalid JSON near offset %zu", (size_t)(it.p - buf));
+        return 0;
+    }
+
+    if (success.kind != JV_NUMBER) {
+        snprintf(err, errsize, "Invalid success field");
+        return 0;
+    }
+    if (sv_eq(success.text, "0")) {
+        if (error.kind == JV_STRING) {
+            char msg[160];
+            snprintf(err, errsize, "API Error: %s", jv_copy(error.text, msg, sizeof(msg)));
+        } else {
+            snprintf(err, errsize, "Unknown API error");
+        }
+        return 0;
+    }
+    if (ret->kind == JV_NONE) {
+        snprintf(err, errsize, "Missing 'return' object");
+        return 0;
+    }
+    return 1;
+}
+
+int tapi_find_orders(const char *buf, size_t len, struct json_view *orders, char *err, size_t errsize) {
+    struct json_view ret;
+    if (!tapi_check_response(buf, len, &ret, err, errsize)) return 0;
+    if (!jv_object_get(&ret, "orders", orders)) {
+        snprintf(err, errsize, "Missing 'orders' object");
+        return 0;
+    }
+    return 1;
+}
+
+static struct strview coin_of(struct strview pair) {
+    struct strview coin = pair;
+    if (pair.len > 4 && memcmp(pair.ptr + pair.len - 4, "_idr", 4) == 0) coin.len -= 4;
+    return coin;
+}
+
+static void walk_order_array(const struct json_view *array, struct strview pair, tapi_order_fn fn, void *ctx) {
+    struct json_iter rows;
+    struct json_view order;
+    struct strview coin = coin_of(pair);
+
+    jv_iter_init(&rows, array);
+    while (jv_array_next(&rows, &order) > 0) {
+        if (order.kind != JV_OBJECT) continue;
+
+        struct tapi_order row;
+        memset(&row, 0, sizeof(row));
+        row.pair = pair;
+        row.coin = coin;
+
+        struct json_iter fields;
+        struct strview key;
+        struct json_view value;
+        jv_iter_init(&fields, &order);
+        while (jv_object_next(&fields, &key, &value) > 0) {
+            if (value.kind != JV_STRING && value.kind != JV_NUMBER) continue;
+            if (sv_eq(key, "price")) row.price = value.text;
+            else if (sv_eq(key, "client_order_id")) row.client_order_id = value.text;
+            else if (sv_eq(key, "type")) row.type = value.text;
+            else if (sv_eq(key, "order_id")) row.order_id = value.text;
+            else if (sv_eq(key, "remain_idr")) row.remain_idr = value.text;
+            else if (key.len == coin.len + 7 && memcmp(key.ptr, "remain_", 7) == 0 &&
+                     memcmp(key.ptr + 7, coin.ptr, coin.len) == 0) row.remain = value.text;
+        }
+        fn(&row, ctx);
+    }
+}
+
+// "orders" is keyed by pair for the all-pairs call and is a bare array when a
+// single pair was requested, in which case pair names it. Returns 0 for any
+// other shape.
+int tapi_walk_orders(const struct json_view *orders, const char *pair, tapi_order_fn fn, void *ctx) {
+    if (orders->kind == JV_OBJECT) {
+        struct json_iter it;
+        struct strview key;
+        struct json_view array;
+        jv_iter_init(&it, orders);
+        while (jv_object_next(&it, &key, &array) > 0) {
+            if (array.kind == JV_ARRAY) walk_order_array(&array, key, fn, ctx);
+        }
+        return 1;
+    }
+    if (orders->kind == JV_ARRAY) {
+        struct strview name = { pair ? pair : "N/A", pair ? strlen(pair) : 3 };
+        walk_order_array(orders, name, fn, ctx);
+        return 1;
+    }
+    return 0;
+}
+
+// Looks keys up in obj assuming they arrive in the same order as the caller's
+// walk, which is how the exchange emits balance and balance_hold. A miss
+// falls back to a scan from the start, so the result is right either way.
+struct lockstep {
+    const struct json_view *obj;
+    struct json_iter it;
+};
+
+static int lockstep_get(struct lockstep *ls, struct strview key, struct json_view *out) {
+    struct strview k;
+    if (jv_object_next(&ls->it, &k, out) > 0 && k.len == key.len && memcmp(k.ptr, key.ptr, k.len) == 0) {
+        return 1;
+    }
+
+    struct json_iter it;
+    jv_iter_init(&it, ls->obj);
+    while (jv_object_next(&it, &k, out) > 0) {
+        if (k.len == key.len && memcmp(k.ptr, key.ptr, k.len) == 0) {
+            ls->it = it;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Picks "balance" and "balance_hold" out of a getInfo return object.
+int tapi_find_balances(const struct json_view *ret, struct json_view *balance, struct json_view *hold) {
+    struct json_iter it;
+    struct strview key;
+    struct json_view value;
+
+    balance->kind = JV_NONE;
+    hold->kind = JV_NONE;
+    jv_iter_init(&it, ret);
+    while (jv_object_next(&it, &key, &value) > 0) {
+        if (sv_eq(key, "balance")) *balance = value;
+        else if (sv_eq(key, "balance_hold")) *hold = value;
+    }
+    return balance->kind == JV_OBJECT && hold->kind == JV_OBJECT;
+}
+
+// Calls fn for every asset in balance with its balance_hold value, then for
+// assets only present in balance_hold.
+void tapi_walk_balances(const struct json_view *balance, const struct json_view *hold, tapi_balance_fn fn, void *ctx) {
+    struct json_iter it;
+    struct strview key;
+    struct json_view value, other;
+
+    struct lockstep ls = { hold, { NULL, NULL } };
+    jv_iter_init(&ls.it, hold);
+    jv_iter_init(&it, balance);
+    while (jv_object_next(&it, &key, &value) > 0) {
+        fn(key, &value, lockstep_get(&ls, key, &other) ? &other : NULL, ctx);
+    }
+
+    ls.obj = balance;
+    jv_iter_init(&ls.it, balance);
+    jv_iter_init(&it, hold);
+    while (jv_object_next(&it, &key, &value) > 0) {
+        if (!lockstep_get(&ls, key, &other)) fn(key, NULL, &value, ctx);
+    }
+}
+
+// A price or amount, quoted or bare, parsed from its own digits. Anything
+// else, or text that is not a number, reads as 0.
+dec64 jv_dec(const struct json_view *v) {
+    dec64 out;
+    if (v->kind != JV_STRING && v->kind != JV_NUMBER) return 0;
+    return dec_parse(v->text.ptr, v->text.len, &out) ? out : 0;
+}
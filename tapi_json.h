@@ -0,0 +1,73 @@
+#ifndef TAPI_JSON_H
+#define TAPI_JSON_H
+
+#include <stddef.h>
+#include "decimal.h"
+
+// On-demand reader for /tapi replies. Nothing is allocated and nothing is
+// copied: every value is a view into the response buffer, and containers
+// nobody asks about are skipped with a structural scan instead of parsed.
+
+struct strview {
+    const char *ptr;        // NULL when the field was absent
+    size_t len;
+};
+
+enum jv_kind {
+    JV_NONE,
+    JV_STRING,
+    JV_NUMBER,
+    JV_OBJECT,
+    JV_ARRAY,
+    JV_TRUE,
+    JV_FALSE,
+    JV_NULL
+};
+
+// A string's text is its raw contents without the quotes (escapes are not
+// decoded, see jv_copy); a container's text spans its brackets.
+struct json_view {
+    enum jv_kind kind;
+    struct strview text;
+};
+
+struct json_iter {
+    const char *p;
+    const char *end;
+};
+
+int jv_parse(const char *buf, size_t len, struct json_view *root, size_t *error_offset);
+void jv_iter_init(struct json_iter *it, const struct json_view *container);
+int jv_object_next(struct json_iter *it, struct strview *key, struct json_view *value);
+int jv_array_next(struct json_iter *it, struct json_view *value);
+int jv_object_get(const struct json_view *obj, const char *key, struct json_view *out);
+
+int sv_eq(struct strview v, const char *s);
+char *jv_copy(struct strview v, char *buf, size_t size);
+dec64 jv_dec(const struct json_view *v);
+
+// One openOrders row. remain is the remain_<coin> field for the row's own coin.
+struct tapi_order {
+    struct strview pair;
+    struct strview coin;
+    struct strview price;
+    struct strview remain;
+    struct strview client_order_id;
+    struct strview type;
+    struct strview order_id;
+    struct strview remain_idr;      // what a buy has left to spend
+};
+
+typedef void (*tapi_order_fn)(const struct tapi_order *order, void *ctx);
+
+// available or hold is NULL when the asset only appears in the other object.
+typedef void (*tapi_balance_fn)(struct strview asset, const struct json_view *available,
+                                const struct json_view *hold, void *ctx);
+
+int tapi_check_response(const char *buf, size_t len, struct json_view *ret, char *err, size_t errsize);
+int tapi_find_orders(const char *buf, size_t len, struct json_view *orders, char *err, size_t errsize);
+int tapi_walk_orders(const struct json_view *orders, const char *pair, tapi_order_fn fn, void *ctx);
+int tapi_find_balances(const struct json_view *ret, struct json_view *balance, struct json_view *hold);
+void tapi_walk_balances(const struct json_view *balance, const struct json_view *hold, tapi_balance_fn fn, void *ctx);
+
+#endif
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tapi_json.h"
+#include "snapshot.h"
+#include "ticker.h"
+
+static int cmp_asset(const void *a, const void *b) {
+    return strcmp(((const struct ticker *)a)->asset, ((const struct ticker *)b)->asset);
+}
+
+// Reads {"tickers":{"btc_idr":{"last":..,"buy":..,"sell":..},...}}. Pairs
+// quoted in anything but IDR are skipped.
+int ticker_parse(struct ticker_table *t, const char *json, size_t len, char *err, size_t errsize) {
+    struct json_view root, tickers, error, entry;
+    size_t offset;
+    memset(t, 0, sizeof(*t));
+
+    if (!jv_parse(json, len, &root, &offset) || root.kind != JV_OBJECT) {
+        snprintf(err, errsize, "JSON error: invalid JSON near offset %zu", offset);
+        return 0;
+    }
+    if (jv_object_get(&root, "error", &error) && error.kind == JV_STRING) {
+        char msg[128];
+        snprintf(err, errsize, "API Error: %s", jv_copy(error.text, msg, sizeof(msg)));
+        return 0;
+    }
+    if (!jv_object_get(&root, "tickers", &tickers) || tickers.kind != JV_OBJECT) {
+        snprintf(err, errsize, "Missing 'tickers' object");
+        return 0;
+    }
+
+    size_t cap = 0;
+    int sorted = 1;
+    struct json_iter it;
+    struct strview pair;
+    jv_iter_init(&it, &tickers);
+    while (jv_object_next(&it, &pair, &entry) > 0) {
+        if (entry.kind != JV_OBJECT || pair.len <= 4 || pair.len - 4 >= sizeof(t->items[0].asset) ||
+            memcmp(pair.ptr + pair.len - 4, "_idr", 4) != 0) {
+            continue;
+        }
+        if (t->count == cap) {
+            cap = cap ? cap * 2 : 256;
+            struct ticker *tmp = realloc(t->items, cap * sizeof(*tmp));
+            if (!tmp) {
+                snprintf(err, errsize, "Memory allocation error");
+                ticker_free(t);
+                return 0;
+            }
+            t->items = tmp;
+        }
+
+        struct ticker *tk = &t->items[t->count];
+        memset(tk, 0, sizeof(*tk));
+        memcpy(tk->asset, pair.ptr, pair.len - 4);
+
+        struct json_iter fields;
+        struct strview key;
+        struct json_view value;
+        jv_iter_init(&fields, &entry);
+        while (jv_object_next(&fields, &key, &value) > 0) {
+            if (sv_eq(key, "last")) tk->last = jv_dec(&value);
+            else if (sv_eq(key, "buy")) tk->bid = jv_dec(&value);
+            else if (sv_eq(key, "sell")) tk->ask = jv_dec(&value);
+        }
+        if (t->count > 0 && strcmp(tk[-1].asset, tk->asset) >= 0) sorted = 0;
+        t->count++;
+    }
+
+    // The exchange lists pairs alphabetically, so this is normally skipped
+    if (!sorted) qsort(t->items, t->count, sizeof(*t->items), cmp_asset);
+    t->fetched_at = time(NULL);
+    return 1;
+}
+
+// The cached snapshot if it is younger than ttl seconds. Tickers are stored
+// already sorted, so a loaded table is ready to merge-join.
+int ticker_load(struct ticker_table *t, const char *path, int ttl) {
+    void *items;
+    memset(t, 0, sizeof(*t));
+    if (!snapshot_load(path, TICKER_MAGIC, TICKER_VERSION, ttl, sizeof(*t->items), &items, &t->count, &t->fetched_at)) {
+        return 0;
+    }
+    t->items = items;
+    return 1;
+}
+
+int ticker_save(const struct ticker_table *t, const char *path) {
+    return snapshot_save(path, TICKER_MAGIC, TICKER_VERSION, t->items, sizeof(*t->items), t->count, t->fetched_at,
+                         "ticker cache");
+}
+
+void ticker_free(struct ticker_table *t) {
+    free(t->items);
+    memset(t, 0, sizeof(*t));
+}
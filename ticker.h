@@ -0,0 +1,31 @@
+#ifndef TICKER_H
+#define TICKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "decimal.h"
+
+#define TICKER_MAGIC 0x54584449u       // "IDXT"
+#define TICKER_VERSION 1
+
+struct ticker {
+    char asset[16];         // base asset of an <asset>_idr pair
+    dec64 last;
+    dec64 bid;
+    dec64 ask;
+};
+
+// Every IDR-quoted pair from one /api/ticker_all snapshot, sorted by asset so
+// it can be merge-joined against a sorted balance list.
+struct ticker_table {
+    struct ticker *items;
+    size_t count;
+    int64_t fetched_at;
+};
+
+int ticker_parse(struct ticker_table *t, const char *json, size_t len, char *err, size_t errsize);
+int ticker_load(struct ticker_table *t, const char *path, int ttl);
+int ticker_save(const struct ticker_table *t, const char *path);
+void ticker_free(struct ticker_table *t);
+
+#endif
@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <string.h>
+#include "decimal.h"
+#include "watch.h"
+
+// FNV-1a, chained over the fields of a row
+static uint64_t hash_str(uint64_t h, const char *s) {
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 0x100000001b3ULL;
+    }
+    return (h ^ 0xff) * 0x100000001b3ULL;
+}
+
+static uint64_t row_hash(const struct watch_row *r) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = hash_str(h, r->pair);
+    h = hash_str(h, r->type);
+    h = hash_str(h, r->price);
+    h = hash_str(h, r->amount);
+    h = hash_str(h, r->hold);
+    return hash_str(h, r->client_order_id);
+}
+
+static struct watch_row *next_row(struct watch_snapshot *s) {
+    if (s->count == s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 256;
+        struct watch_row *tmp = realloc(s->rows, cap * sizeof(*tmp));
+        if (!tmp) return NULL;
+        s->rows = tmp;
+        s->cap = cap;
+    }
+    struct watch_row *r = &s->rows[s->count++];
+    memset(r, 0, sizeof(*r));
+    return r;
+}
+
+static int cmp_key(const void *a, const void *b) {
+    return strcmp(((const struct watch_row *)a)->key, ((const struct watch_row *)b)->key);
+}
+
+// The exchange tends to list rows in a stable order, so sorting is usually
+// just the check.
+static void finish(struct watch_snapshot *s) {
+    for (size_t i = 1; i < s->count; i++) {
+        if (strcmp(s->rows[i - 1].key, s->rows[i].key) > 0) {
+            qsort(s->rows, s->count, sizeof(*s->rows), cmp_key);
+            return;
+        }
+    }
+}
+
+struct order_fill {
+    struct watch_snapshot *s;
+    int failed;
+};
+
+static void add_order(const struct tapi_order *o, void *ctx) {
+    struct order_fill *f = ctx;
+    struct watch_row *r = next_row(f->s);
+    if (!r) {
+        f->failed = 1;
+        return;
+    }
+    // Orders placed elsewhere may lack a client_order_id but never an order_id
+    jv_copy(o->order_id.len ? o->order_id : o->client_order_id, r->key, sizeof(r->key));
+    jv_copy(o->pair, r->pair, sizeof(r->pair));
+    jv_copy(o->type, r->type, sizeof(r->type));
+    jv_copy(o->price, r->price, sizeof(r->price));
+    // A buy's own-coin remain is absent; what it has left to spend shows fills
+    jv_copy(o->remain.len ? o->remain : o->remain_idr, r->amount, sizeof(r->amount));
+    jv_copy(o->client_order_id, r->client_order_id, sizeof(r->client_order_id));
+    r->hash = row_hash(r);
+}
+
+// Replaces s with the rows of an openOrders "orders" value.
+int watch_snapshot_orders(struct watch_snapshot *s, const struct json_view *orders, const char *pair) {
+    struct order_fill f = { s, 0 };
+    s->count = 0;
+    if (!tapi_walk_orders(orders, pair, add_order, &f) || f.failed) return 0;
+    finish(s);
+    return 1;
+}
+
+static void add_balance(struct strview asset, const struct json_view *available,
+                        const struct json_view *hold, void *ctx) {
+    struct order_fill *f = ctx;
+    dec64 a = 0, h = 0;
+    if (available && (available->kind == JV_STRING || available->kind == JV_NUMBER)) {
+        dec_parse(available->text.ptr, available->text.len, &a);
+    }
+    if (hold && (hold->kind == JV_STRING || hold->kind == JV_NUMBER)) {
+        dec_parse(hold->text.ptr, hold->text.len, &h);
+    }
+    if (a == 0 && h == 0) return;
+
+    struct watch_row *r = next_row(f->s);
+    if (!r) {
+        f->failed = 1;
+        return;
+    }
+    jv_copy(asset, r->key, sizeof(r->key));
+    dec_format(a, r->amount, sizeof(r->amount));
+    dec_format(h, r->hold, sizeof(r->hold));
+    r->hash = row_hash(r);
+}
+
+// Replaces s with the non-zero balances of a getInfo "return" value.
+int watch_snapshot_balances(struct watch_snapshot *s, const struct json_view *ret) {
+    struct json_view balance, hold;
+    struct order_fill f = { s, 0 };
+    s->count = 0;
+    if (!tapi_find_balances(ret, &balance, &hold)) return 0;
+    tapi_walk_balances(&balance, &hold, add_balance, &f);
+    if (f.failed) return 0;
+    finish(s);
+    return 1;
+}
+
+// Merges two sorted snapshots and calls fn for every row that appeared,
+// changed or went away. Returns the number of changes.
+size_t watch_diff(const struct watch_snapshot *prev, const struct watch_snapshot *cur, watch_fn fn, void *ctx) {
+    size_t i = 0, j = 0, changes = 0;
+    while (i < prev->count || j < cur->count) {
+        const struct watch_row *p = i < prev->count ? &prev->rows[i] : NULL;
+        const struct watch_row *c = j < cur->count ? &cur->rows[j] : NULL;
+        int cmp = !p ? 1 : !c ? -1 : strcmp(p->key, c->key);
+
+        if (cmp < 0) {
+            fn(WATCH_GONE, p, NULL, ctx);
+            changes++;
+            i++;
+        } else if (cmp > 0) {
+            fn(WATCH_NEW, NULL, c, ctx);
+            changes++;
+            j++;
+        } else {
+            if (p->hash != c->hash) {
+                fn(WATCH_CHANGED, p, c, ctx);
+                changes++;
+            }
+            i++;
+            j++;
+        }
+    }
+    return changes;
+}
+
+void watch_snapshot_free(struct watch_snapshot *s) {
+    free(s->rows);
+    memset(s, 0, sizeof(*s));
+}
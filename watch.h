@@ -0,0 +1,44 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "tapi_json.h"
+
+// One row of a polled snapshot: an open order keyed by order_id, or a
+// balance keyed by asset. hash covers every field but the key, so an
+// unchanged row is recognised without comparing strings.
+struct watch_row {
+    uint64_t hash;
+    char key[48];
+    char pair[24];
+    char type[8];
+    char price[32];
+    char amount[40];        // remaining amount for orders, available for balances
+    char hold[40];          // balances only
+    char client_order_id[64];
+};
+
+// Rows sorted by key so two snapshots diff in one merge pass. The buffer is
+// kept across polls.
+struct watch_snapshot {
+    struct watch_row *rows;
+    size_t count;
+    size_t cap;
+};
+
+enum watch_change {
+    WATCH_NEW,              // only in the current snapshot
+    WATCH_CHANGED,          // in both, hash differs
+    WATCH_GONE              // only in the previous snapshot
+};
+
+typedef void (*watch_fn)(enum watch_change change, const struct watch_row *prev,
+                         const struct watch_row *cur, void *ctx);
+
+int watch_snapshot_orders(struct watch_snapshot *s, const struct json_view *orders, const char *pair);
+int watch_snapshot_balances(struct watch_snapshot *s, const struct json_view *ret);
+size_t watch_diff(const struct watch_snapshot *prev, const struct watch_snapshot *cur, watch_fn fn, void *ctx);
+void watch_snapshot_free(struct watch_snapshot *s);
+
+#endif